@@ -35,8 +35,9 @@ Further info at: https://github.com/arduino-libraries/Arduino_DebugUtils
     #define VERSION     "0.1.0"         // Version of the Purr Pleaser
     #define PP_MODEL    "PP3000S"       // Model (e.g. PP3000S for Single Feeder, PP3000D for Double Feeder)
 
-    // Cat Name
+    // Cat Names
     #define NAME_CAT_1  "Maya"          // Name of the cat
+    #define NAME_CAT_2  "Luna"          // Name of the second cat (only used with FEED_CHANNELS 2)
 
     // Default Food Settings
     #define MAX_DAILY   80              // Max daily food amount (g) - as settable by Home Assistant
@@ -77,20 +78,34 @@ Further info at: https://github.com/arduino-libraries/Arduino_DebugUtils
     // Driver (here default for TMC2209)
     // (Library settings (TMCStepper.h) can be found at: https://teemuatlut.github.io/TMCStepper/class_t_m_c2209_stepper.html)
     #define DRIVER_ENABLE       2           // Enable Pin
+    #define IDLE_POWER          false       // Keep the drivers powered in IDLE (true): the motors hold their position and FEED skips the full homing; false = power off in IDLE
     #define SERIAL_PORT_1       Serial1     // HardwareSerial port (TX: 0, RX: 1)
     #define R_SENSE             0.11f       // Sense resistor value of the driver fur current cal.
     #define CURRENT             600         // Max current (mA) supplied to the motor
     #define STALL_VALUE         0           // Stall threshold [0..255] (lower = more sensitive) >> use AutotuneStall(bool quickCheck) to find the best value. Set to 0 if you want stall values loaded from file.
     #define AUTO_STALL_RED      true        // This allows for automatic stall threshold reduction / adaption (not part of TMCStepper library)
     #define MIRCO_STEPS         32          // Set microsteps (32 is a good compromise between CPU load and noise)
+    #define FAST_MICRO_STEPS    MIRCO_STEPS // Microsteps for the MoveCycle strokes (fewer step pulses, positions stay in MIRCO_STEPS); MIRCO_STEPS = disabled, e.g. 8 once tested on the board
     #define TCOOLS              400         // max 20 bits
     #define EMGY_CURRENT        1000        // Emergency current (mA) (default 1000mA)
 
     // Steppers Motor (NEMA 17)
     #define SPEED               10000       // Speed (steps/s) (10000 is good)
     #define ACCEL               100000      // Acceleration (steps/s^2) (100000	is good)
+    #define MAX_STROKE_SPEED    0           // Adaptive feeding strokes (STEP_MODE 1 or 2): speed follows the load (StallGuard) up to this speed (steps/s), down to SPEED/2; 0 = fixed SPEED
+    #define HOMING_FAST_SPEED   0           // Homing approach speed (steps/s) toward an endstop (0 = SPEED); faster is not validated on the board yet
+    #define HOMING_SLOW_SPEED   1000        // Homing re-probe speed (steps/s) after backing off the endstop (0 = single speed homing); needs an endstop
+    #define HOMING_BACKOFF      400         // Distance (steps) to back off the endstop before the re-probe
     #define STD_FEED_DIST       4600        // Standard range (steps) the slider should moves when feeding (4600 is good)
     #define PUMP_MAX_RANGE      6000        // Max range (steps) the slider can move inside the pump (6000 is good)
+    #define STEP_MODE           0           // Step generation (1 and 2 are not validated on the board yet): 0 = polled from loop1, 1 = hardware timer interrupt (moves keep running while core 1 is busy), 2 = PIO + DMA (no CPU load per step; allows speeds above 10000, ramps limited to 1024 steps)
+    #define FIXED_STEP_PINS     false       // STEP_MODE 1: step interrupts pulse the step pins with masks known at compile time (SpeedyStepper4PurrFixed.h) (true) or the runtime mask (false)
+    #define FIXED_RAMP          false       // Ramp math: true = fixed point (no soft float on the RP2040, step periods within 1us of float, see test/FixedRampTest.cpp; not validated on the board yet), false = float (original)
+    #define RAMP_TABLE          false       // Ramp table computed at compile time for SPEED and ACCEL (true; not validated on the board yet) or ramp computed for every move (false)
+    #define S_CURVE             false       // Feeding moves with jerk limited S-curve profile (true) or constant acceleration (false); homing always uses constant acceleration
+    #define JERK                20000000    // Jerk (steps/s^3) for S_CURVE, ACCEL is then the max. acceleration (min. 22000; ramp limited to 1024 steps)
+    #define CHECK_TRAJECTORY    false       // Check the planned feeding moves against SPEED / ACCEL at start (no motion), reports excess (%) and planning time per step
+    #define VACTUAL_MOVES       false       // Homing approach and MoveCycle strokes in VACTUAL mode (driver's pulse generator, needs an endstop) (true) or STEP/DIR (false)
 
     // Stepper Motor 0
     #define MOTOR_0             0           // Unique device number
@@ -116,8 +131,27 @@ Further info at: https://github.com/arduino-libraries/Arduino_DebugUtils
     #define DATA_PIN_1          12          // Data pin for scale 1
     #define CLOCK_PIN_1         14          // Clock pin for scale 1
 
+    // Feeding Channels
+    #define FEED_CHANNELS       1           // Pumps with scale, one per cat (1 or 2, 2 needs STEP_MODE 1 or 2); all feed at the same time and share the dumper drive (Motor 0)
+
+    // Stepper Motor 2 and Scale 2 (only used with FEED_CHANNELS 2)
+    // Note, the PP3000S board has no second pump, the pins below are free pins of the Pico W. Please set them to your layout.
+    #define MOTOR_2             2           // Unique device number
+    #define STEP_2              10          // Step pin
+    #define DIR_2               11          // Direction pin
+    #define LIMIT_2             22          // Limit switch pin (99 = via expander MCP23017)
+    #define DIAG_2              9           // DIAG pin for stall detection
+    #define DRIVER_ADDRESS_2    0b01        // Drivers address
+    #define DIR_TO_HOME_2       -1          // Direction to home (1 = CW, -1 = CCW)
+    #define SCALE_2             4           // Unique device number
+    #define SCALE_NVM_2         2           // Memory Address (for permanent calibration data)
+    #define DATA_PIN_2          13          // Data pin for scale 2
+    #define CLOCK_PIN_2         15          // Clock pin for scale 2
+
     // Special Settings
+    // NOTE, both offsets adapt to the learned accuracy of the pump after a few feedings (0.25x - 2x)
     #define APP_OFFSET          4.0         // Offset in g for approx. feeding (default 4g)
+    #define DOSE_TRIM           1.0         // Offset in g for planned strokes, rest is trimmed (default 1g)
     #define EMGY_CYCLES         4           // Feeding cycles in EMGY mode (no measuring etc.) (default 4)
 
     // IR Food Sensor
@@ -125,6 +159,8 @@ Further info at: https://github.com/arduino-libraries/Arduino_DebugUtils
     #define SIDE_IR_1           20          // Side fill sensor (to measure min. food level)
     #define TOP_FILL            true        // Use top fill sensor (true) or not (false)
     #define TOP_IR_1            21          // Top fill sensor pin (to measure max. food level)
+    #define SIDE_IR_2           26          // Side fill sensor of the second container (FEED_CHANNELS 2)
+    #define TOP_IR_2            27          // Top fill sensor of the second container (FEED_CHANNELS 2)
 
     // Capacity
     #define HIGH_CAP            1000        // Capacity of the food container (g) - top fill sensor
@@ -48,6 +48,7 @@
 #include "PP3000S_CONFIG.h"
 #include "src/FoodSchedule.h"
 #include "src/FP3000.h"
+#include "src/RampTable.h"
 // ---------------------------------------------------------*
 
 // CREATE DEVICES:
@@ -59,9 +60,18 @@ MCP23017 mcp = MCP23017(MCP_ADDRESS);		// (Don't delete, aut. ignored if EXPANDE
 FP3000 DumperDrive(MOTOR_0, STD_FEED_DIST, PUMP_MAX_RANGE, DIR_TO_HOME_0, SPEED, STALL_VALUE,
 	AUTO_STALL_RED, SERIAL_PORT_1, R_SENSE, DRIVER_ADDRESS_0, mcp, EXPANDER, MCP_INTA);
 
-// Pump
-FP3000 Pump_1(MOTOR_1, STD_FEED_DIST, PUMP_MAX_RANGE, DIR_TO_HOME_1, SPEED, STALL_VALUE,
-	AUTO_STALL_RED, SERIAL_PORT_1, R_SENSE, DRIVER_ADDRESS_1, mcp, EXPANDER, MCP_INTA);
+// Pumps (one per feeding channel, see FEED_CHANNELS and channelConfig below)
+FP3000 Pumps[FEED_CHANNELS] = {
+	FP3000(MOTOR_1, STD_FEED_DIST, PUMP_MAX_RANGE, DIR_TO_HOME_1, SPEED, STALL_VALUE,
+		AUTO_STALL_RED, SERIAL_PORT_1, R_SENSE, DRIVER_ADDRESS_1, mcp, EXPANDER, MCP_INTA),
+#if FEED_CHANNELS > 1
+	FP3000(MOTOR_2, STD_FEED_DIST, PUMP_MAX_RANGE, DIR_TO_HOME_2, SPEED, STALL_VALUE,
+		AUTO_STALL_RED, SERIAL_PORT_1, R_SENSE, DRIVER_ADDRESS_2, mcp, EXPANDER, MCP_INTA),
+#endif
+};
+
+// Ramp Table (step periods for SPEED and ACCEL, computed at compile time)
+constexpr RampTable<SPEED, ACCEL> rampTable;
 // -------------------------------------------------------------------------------------------*
 
 // SET TIMEZONE:
@@ -89,8 +99,40 @@ enum FPMode : byte {
 // The mode is set by Core 0. Default is IDLE.
 byte Mode_c1 = IDLE;
 
+// Feeding Channels
+// Each channel is one pump with its scale (one per cat), all channels share the dumper drive.
+// To add a channel, raise FEED_CHANNELS and add its settings here and to Pumps (above).
+static_assert(FEED_CHANNELS >= 1 && FEED_CHANNELS <= 2, "FEED_CHANNELS: the feeding schedule holds 1 or 2 cats");
+// The channels feed in turn from loop1, a blocking scale measurement (Measure) of one channel stops the polled steps of
+// the other channel's pump; with a step interrupt or the PIO its moves keep running.
+#if FEED_CHANNELS > 1 && STEP_MODE == 0
+#error "FEED_CHANNELS 2 needs STEP_MODE 1 or 2 (polled steps stall while the other channel weighs)"
+#endif
+#if FEED_CHANNELS > 1 && !defined(NAME_CAT_2)
+#error "FEED_CHANNELS 2 needs NAME_CAT_2 (name of the second cat, see PP3000S_CONFIG.h)"
+#endif
+struct ChannelConfig {
+	byte motor;				// Device number of the pump
+	byte stepPin;
+	byte dirPin;
+	byte limitPin;
+	byte diagPin;
+	byte scale;				// Device number of the scale
+	byte scaleNvm;			// Memory address of the scale calibration
+	byte dataPin;
+	byte clockPin;
+	byte sideIR;			// Fill sensors of the food container
+	byte topIR;
+};
+const ChannelConfig channelConfig[FEED_CHANNELS] = {
+	{ MOTOR_1, STEP_1, DIR_1, LIMIT_1, DIAG_1, SCALE_1, SCALE_NVM_1, DATA_PIN_1, CLOCK_PIN_1, SIDE_IR_1, TOP_IR_1 },
+#if FEED_CHANNELS > 1
+	{ MOTOR_2, STEP_2, DIR_2, LIMIT_2, DIAG_2, SCALE_2, SCALE_NVM_2, DATA_PIN_2, CLOCK_PIN_2, SIDE_IR_2, TOP_IR_2 },
+#endif
+};
+
 // Treat Amounts (can also be used to trigger manual feeding with a specific amount)
-float treatAmount1 = TREAT_AMT;
+float treatAmount[FEED_CHANNELS];
 
 // ===========================================================================================*
 
@@ -160,33 +202,87 @@ void setup1() {
 	// Pin Setup
 	pinMode(DRIVER_ENABLE, OUTPUT);
 	pinMode(LED_BUILTIN, OUTPUT);
-	pinMode(DIAG_1, INPUT);
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		pinMode(channelConfig[c].diagPin, INPUT);
+	}
 	digitalWrite(DRIVER_ENABLE, HIGH);				// Disable Driver
 	digitalWrite(LED_BUILTIN, LOW);					// Visual indication that PurrPleaser is not started.
 
 	// Driver Setup
 	SERIAL_PORT_1.begin(115200);
 
-	// Setup Pump
+	// Setup Pumps
 	byte setupResult = NOT_STARTED;					// Return from setup functions
 	digitalWrite(DRIVER_ENABLE, LOW);				// Enable Driver
 
+	// Ramp table (computed at compile time for SPEED and ACCEL)
+	if (RAMP_TABLE) {
+		DumperDrive.SetRampTable(rampTable.period, rampTable.length, rampTable.speed, rampTable.accel);
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			Pumps[c].SetRampTable(rampTable.period, rampTable.length, rampTable.speed, rampTable.accel);
+		}
+	}
+
+	// S-curve profile for feeding moves
+	if (S_CURVE) {
+		DumperDrive.SetSCurve(JERK);
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			Pumps[c].SetSCurve(JERK);
+		}
+	}
+
+	// Coarse moves in VACTUAL mode, strokes with fewer microsteps
+	DumperDrive.SetVactualMoves(VACTUAL_MOVES);
+	DumperDrive.SetHomingSpeeds(HOMING_FAST_SPEED, HOMING_SLOW_SPEED, HOMING_BACKOFF);
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		Pumps[c].SetVactualMoves(VACTUAL_MOVES);
+		Pumps[c].SetFastMicrosteps(FAST_MICRO_STEPS);
+		Pumps[c].SetAdaptiveSpeed((STEP_MODE != 0) ? MAX_STROKE_SPEED : 0);	// UART reads would delay polled steps
+		Pumps[c].SetHomingSpeeds(HOMING_FAST_SPEED, HOMING_SLOW_SPEED, HOMING_BACKOFF);
+	}
+
 	// Setup Motor 0
-	setupResult = DumperDrive.SetupMotor(CURRENT, MIRCO_STEPS, TCOOLS, STEP_0, DIR_0, LIMIT_0, DIAG_0, ACCEL);
+	setupResult = DumperDrive.SetupMotor(CURRENT, MIRCO_STEPS, TCOOLS, STEP_0, DIR_0, LIMIT_0, DIAG_0, ACCEL, STEP_MODE, FIXED_RAMP);
 	if (setupResult != OK) {
 		ReceiveWarningsErrors_c1(DumperDrive, MOTOR_0);			// (Support Function)
 	}
 
-	// Setup Motor 1
-	setupResult = Pump_1.SetupMotor(CURRENT, MIRCO_STEPS, TCOOLS, STEP_1, DIR_1, LIMIT_1, DIAG_1, ACCEL);
-	if (setupResult != OK) {
-		ReceiveWarningsErrors_c1(Pump_1, MOTOR_1);				// (Support Function)
+	// Setup Pump Motors
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		const ChannelConfig& cfg = channelConfig[c];
+		setupResult = Pumps[c].SetupMotor(CURRENT, MIRCO_STEPS, TCOOLS, cfg.stepPin, cfg.dirPin, cfg.limitPin, cfg.diagPin, ACCEL, STEP_MODE, FIXED_RAMP);
+		if (setupResult != OK) {
+			ReceiveWarningsErrors_c1(Pumps[c], cfg.motor);			// (Support Function)
+		}
 	}
 
-	// Setup Scale 1
-	setupResult = Pump_1.SetupScale(SCALE_NVM_1, DATA_PIN_1, CLOCK_PIN_1);
-	if (setupResult != OK) {
-		ReceiveWarningsErrors_c1(Pump_1, SCALE_1);				// (Support Function)
+	// Step interrupts with the step pins fixed at compile time (a motor on another pin keeps the runtime step interrupt)
+	if (FIXED_STEP_PINS && STEP_MODE == 1) {
+		DumperDrive.SetFixedStepPin<STEP_0>();
+		Pumps[0].SetFixedStepPin<STEP_1>();
+#if FEED_CHANNELS > 1
+		Pumps[1].SetFixedStepPin<STEP_2>();
+#endif
+	}
+
+	// Check the planned velocity profiles (no motion)
+	if (CHECK_TRAJECTORY) {
+		uint16_t nsPerStep;
+		PackPushData('P', MOTOR_0, DumperDrive.CheckTrajectory(nsPerStep));	// (Support Function)
+		PackPushData('N', MOTOR_0, nsPerStep);								// (Support Function)
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			PackPushData('P', channelConfig[c].motor, Pumps[c].CheckTrajectory(nsPerStep));	// (Support Function)
+			PackPushData('N', channelConfig[c].motor, nsPerStep);							// (Support Function)
+		}
+	}
+
+	// Setup Scales
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		const ChannelConfig& cfg = channelConfig[c];
+		setupResult = Pumps[c].SetupScale(cfg.scaleNvm, cfg.dataPin, cfg.clockPin);
+		if (setupResult != OK) {
+			ReceiveWarningsErrors_c1(Pumps[c], cfg.scale);			// (Support Function)
+		}
 	}
 
 	// Setup finished
@@ -255,28 +351,29 @@ void loop1() {
 		ACCURATE,
 		EMPTY
 	};
-	static byte feedMode = PRIME;
 
-	// Variables for Priming
+	// Feeding State of each Channel (each channel feeds on its own, see FEED)
+	struct FeedState {
+		byte feedMode = PRIME;
+		byte pumpReturn = BUSY;		// Return of the pump (Priming and Emptying)
+		float feedingAmount = 10.0;	// Feeding Amount in g (default 10g)
+		float lastFed = 0.0;		// Amount fed last time (default 0g)
+		float feedingTarget = 10.0;	// Feeding target in g, corrected by the learned bias (see FP3000::DoseTarget)
+		float fed = 0.0;			// Amount measured while feeding (APPROX / ACCURATE)
+		long plannedSteps = -1;		// Planned steps (see FP3000::PlanDose, -1 = plan again)
+		byte feedCycles = 0;		// Feeding Cycles (checks for empty scale)
+		bool finalMeasured = false;	// Final measurement done (EMPTY)
+	};
+	static FeedState channel[FEED_CHANNELS];
+	float feedingAmounts[FEED_CHANNELS];
+
+	// Variables for Priming (and Emptying)
 	static byte dumperReturn = BUSY;
-	static byte pump1Return = BUSY;
 
 	// Calibration Status (check numbers in CALIBRATE below)
 	byte calStatus = 0;
 	byte prevCalStatus = 1;
 
-	// Feeding Amount in g (default 10g)
-	static float feedingAmount_1 = 10.0;
-
-	// Amount fed last time (default 0g)
-	static float lastFed_1 = 0.0;
-
-	// Feeding Amount correction in g (default 0g)
-	static float feedingCorrection_1 = 0.0;
-
-	// Feeding Cycles (checks for empty scale)
-	static byte feedCycles = 0;
-
 	// Time keeping for intervals
 	static unsigned long lastTime = 0;
 	const unsigned long checkInterval = 10000; // 10 seconds
@@ -287,8 +384,14 @@ void loop1() {
 	// Operation Mode Settings
 	// --------------------------------------------------------------------------------------------------------
 
-	// Set Mode (and if available feeding amount) - from Core 0
-	PopData_c1(Mode_c1, feedingAmount_1);					// (Support Function)
+	// Set Mode (and if available feeding amounts) - from Core 0
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		feedingAmounts[c] = channel[c].feedingAmount;
+	}
+	PopData_c1(Mode_c1, feedingAmounts);					// (Support Function)
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		channel[c].feedingAmount = feedingAmounts[c];
+	}
 
 	// Check if Mode_c1 is in its allowed range and send to Core 0 if changed.
 	static byte oldMode_c1 = 99;							// force sending at start (e.g. after reset)
@@ -315,11 +418,20 @@ void loop1() {
 		// commands from Core 0.
 		// ===============================================================
 
-		// Power Off unused devices
-		Power_c1(false);							// Toggle e.g. Driver On/Off (Support Function)
+		// Power Off unused devices (the motors can then turn freely, so their position is lost)
+		if (!IDLE_POWER) {
+			Power_c1(false);						// Toggle e.g. Driver On/Off (Support Function)
+			DumperDrive.InvalidatePosition();
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				Pumps[c].InvalidatePosition();
+			}
+		}
 
-		// Reset Feed Mode
-		feedMode = PRIME;							// Reset feeding mode
+		// Reset Feed Modes
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			channel[c].feedMode = PRIME;			// Reset feeding mode
+			channel[c].finalMeasured = false;		// Reset final measurement
+		}
 
 		// Check every 10 seconds fill level
 		if (currentTime - lastTime >= checkInterval) {
@@ -339,192 +451,295 @@ void loop1() {
 		// in grams by the selected scale. The feeding process works in
 		// four steps:
 		// 1. Prime: Go to start position (endstops) and tare the scale.
-		// 2. Approx.: Move slider up and down to get an approximate
-		//    amount of food, close to the desired amount (APP_OFFSET).
+		// 2. Approx.: Plan the strokes with the learned grams per step
+		//    and dispense close to the desired amount (DOSE_TRIM), in
+		//    full strokes and one partial stroke. Until something is
+		//    learned, full strokes up to APP_OFFSET.
 		// 3. Accurate: Move slider in a precise filling motion until
 		//    the desired amount is reached.
-		// 4. Empty: Do a final measurement and empty the scale dumper.
-		// NOTE, the final scale reading is sent to Core 0. Whereat
-		// Core 0 should save the data in order to compensate a given 
-		// error in the next feeding process. (E.g. if the pump has
-		// dispensed 2g too much, Core 0 should subtract 2g from the next
-		// feeding command.)
+		// 4. Empty: Do a final measurement (learns the grams per step)
+		//    and empty the scale dumper.
+		// All channels (pumps with scale) prime together with the dumper
+		// drive. Then each channel feeds on its own (at the same time as
+		// the others) and the dumper empties all scales, once every
+		// channel has done its final measurement.
+		// NOTE, the final scale reading is sent to Core 0. The pump
+		// learns its bias and variance from it, aims the next feedings
+		// by the bias (e.g. if it dispenses 2g too much on average, it
+		// aims 2g lower) and adapts APP_OFFSET / DOSE_TRIM to the
+		// variance. Bias and deviation are sent to Core 0 as well.
 		// ===============================================================
 
-		switch (feedMode) {
-			// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-		case PRIME:
+		// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+		// PRIME (all channels)
+		if (channel[0].feedMode == PRIME) {
 			// Turn on secondary power
 			Power_c1(true);													// (Support Function)
 
 			// Prime Dumper Drive
 			if (dumperReturn == BUSY) {
 				dumperReturn = DumperDrive.Prime();
+				ReportRecovery_c1(DumperDrive, MOTOR_0);					// (Support Function)
 				if (dumperReturn == ERROR || dumperReturn == WARNING) {
 					ReceiveWarningsErrors_c1(DumperDrive, MOTOR_0);			// (Support Function)
 				}
 			}
 
-			// Wait for Dumper Drive to finish, then Prime Pump 1
-			else if (pump1Return == BUSY) {
-				pump1Return = Pump_1.Prime();
-				if (pump1Return == ERROR || pump1Return == WARNING) {
-					ReceiveWarningsErrors_c1(Pump_1, MOTOR_1);				// (Support Function)
+			// Prime the Pumps at the same time (the scales are tared below, once the dumper is at rest).
+			// With the expander, all endstops share one interrupt, so prime one after the other.
+			bool primed = (dumperReturn != BUSY);
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				FeedState& ch = channel[c];
+				if (ch.pumpReturn == BUSY && (!EXPANDER || primed)) {
+					ch.pumpReturn = Pumps[c].Prime(false);
+					ReportRecovery_c1(Pumps[c], channelConfig[c].motor);		// (Support Function)
+					if (ch.pumpReturn == ERROR || ch.pumpReturn == WARNING) {
+						ReceiveWarningsErrors_c1(Pumps[c], channelConfig[c].motor);	// (Support Function)
+					}
 				}
+				primed = primed && ch.pumpReturn != BUSY;
 			}
 
 			// Check if priming is finished.
-			if (dumperReturn != BUSY && pump1Return != BUSY) {
+			if (!primed) {
+				break;
+			}
 
-				// Reset Flags
-				dumperReturn = BUSY;
-				feedMode = APPROX;
+			// Report homing durations
+			PackPushData('H', MOTOR_0, DumperDrive.HomingTime());				// (Support Function)
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				PackPushData('H', channelConfig[c].motor, Pumps[c].HomingTime());	// (Support Function)
+			}
 
-				// Correct feeding amount by past offset (when too much or too little food was dispensed last time)
-				// Note, correction will be neglected if that leads to a feeding <= 1g or > MAX_SINGLE (see config).
-				float newFA = feedingAmount_1 + feedingCorrection_1;
-				if (newFA > 1 && newFA <= MAX_SINGLE) {
-					feedingAmount_1 = newFA;
-				}
+			// Reset Flags
+			dumperReturn = BUSY;
+
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				FeedState& ch = channel[c];
 
-				// Pump 1 - check amount to decide if approx. feeding is needed
-				if (feedingAmount_1 <= APP_OFFSET) {
-					// Approx. amount allready  reached, skip app. feeding.
-					pump1Return = OK;
+				// Tare Scale
+				if (ch.pumpReturn == OK) {
+					Pumps[c].TareScale();
 				}
-				else {
-					pump1Return = BUSY;
+
+				// Correct feeding amount by the learned bias (when too much or too little food is dispensed on average)
+				// Note, correction will be neglected if that leads to a feeding <= 1g or > MAX_SINGLE (see config).
+				ch.feedingTarget = Pumps[c].DoseTarget(ch.feedingAmount);
+				if (ch.feedingTarget <= 1 || ch.feedingTarget > MAX_SINGLE) {
+					ch.feedingTarget = ch.feedingAmount;
 				}
+
+				// Plan from an empty scale (APPROX decides if strokes are needed)
+				ch.fed = 0;
+				ch.plannedSteps = -1;
+				ch.pumpReturn = BUSY;
+				ch.feedMode = APPROX;
 			}
 			break;
-			// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-		case APPROX:
-			// Do one cycle, then check if the desired amount (APP_OFFSET)
-			// is reached (measure 2 times). If, then stop; if not, do another cycle.	
+		}
+		// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+		// Feed each channel
+		for (byte c = 0; c < FEED_CHANNELS && Mode_c1 == FEED; c++) {
+			FeedState& ch = channel[c];
+			FP3000& pump = Pumps[c];
+
+			switch (ch.feedMode) {
+				// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+			case APPROX:
+				// Plan the steps to DOSE_TRIM below the desired amount, do the full strokes
+				// of the plan in one go, then measure (2 times, the scale is read while the
+				// slider returns, see FP3000::StrokeWeight) and plan again. The rest
+				// (less than a full stroke) is dispensed with one partial stroke, after
+				// which the slider stays out for the accurate feeding.
+				// Until grams per step are learned, do full strokes and measure after each
+				// one, until the approx. amount (APP_OFFSET) is reached.
+
+				if (ch.pumpReturn == BUSY) {
+
+					// Plan the strokes
+					if (ch.plannedSteps < 0) {
+						ch.plannedSteps = pump.PlanDose(ch.feedingTarget - pump.DoseOffset(DOSE_TRIM) - ch.fed);
+						if (ch.plannedSteps < 0) {
+							// Nothing learned yet
+							ch.plannedSteps = (ch.fed < ch.feedingTarget - pump.DoseOffset(APP_OFFSET)) ? pump.DoseStroke() : 0;
+						}
+					}
 
-			// Pump 1
-			if (pump1Return == BUSY) {
-				if (Pump_1.MoveCycle() != BUSY) {
-					if (Pump_1.Measure(2) >= feedingAmount_1 - APP_OFFSET) {
-						// Approx. amount reached, ready for accurate feeding.
-						pump1Return = OK;
+					if (ch.plannedSteps >= pump.DoseStroke()) {
+						// Full strokes
+						if (pump.MoveCycle() != BUSY) {
+							// Increase feed cycles (checking for empty scale)
+							ch.feedCycles++;
+							ch.plannedSteps -= pump.DoseStroke();
+							if (ch.plannedSteps < pump.DoseStroke()) {
+								// Full strokes done, check amount (weighed on the way back) and plan again
+								ch.fed = pump.StrokeWeight(2);
+								ch.plannedSteps = -1;
+							}
+						}
+					}
+					else if (ch.plannedSteps > 0) {
+						// Partial stroke, approx. amount reached, ready for accurate feeding.
+						if (pump.MoveDose(ch.plannedSteps) != BUSY) {
+							ch.fed = pump.Measure(2);
+							ch.pumpReturn = OK;
+						}
 					}
 					else {
-						// Increase feed cycles (checking for empty scale)
-						feedCycles++;
+						// Approx. amount reached, ready for accurate feeding.
+						ch.pumpReturn = OK;
 					}
 				}
-			}
-
-			// Check if approx. amount is reached
-			if (pump1Return == OK) {
-				// Reset feed cycles, flags and go to accurate feeding.
-				feedCycles = 0;
-
-				// Check if feeding amount is allready reached, then skip accurate feeding.
-				// (Also, if feeding amount is set to 0.)
-				if (Pump_1.Measure(5) >= feedingAmount_1 || feedingAmount_1 == 0) {
-					pump1Return = OK;
-				}
-				else {
-					// Amount not yet reached, Pump still busy / ready for accurate feeding.
-					pump1Return = BUSY;
-				}
 
-				// Go to accurate feeding (will skip the actual steps if feeding amount is reached)
-				feedMode = ACCURATE;
-			}
+				// Check if approx. amount is reached
+				if (ch.pumpReturn == OK) {
+					// Reset feed cycles, flags and go to accurate feeding.
+					ch.feedCycles = 0;
+					ch.plannedSteps = -1;
 
-			// Check if approx. amount is not reached after 10 cycles (at least one pump)
-			if (feedCycles >= 10) {
-				feedCycles = 0; // Reset feed cycles
-				// Switch to emergency feeding, since approx.
-				// amount is not reached after 10 cycles.
-				PackPushData('E', 99, 6); // 99 - no device, 6 - Empty or scale broken (Support Function)
-				Mode_c1 = EMGY;
-			}
-			break;
-			// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-		case ACCURATE:
-			// Accurate
-			// Move slider in a precise filling motion until the desired amount is reached.
-
-			// Pump 1
-			if (pump1Return == BUSY) {
-				if (Pump_1.MoveCycleAccurate() != BUSY) {
-					if (Pump_1.Measure(3) >= feedingAmount_1) {
-						// Final amount reached, ready for final step (EMPTY).
-						pump1Return = OK;
+					// Check if feeding amount is allready reached, then skip accurate feeding.
+					// (Also, if feeding amount is set to 0.)
+					if (ch.fed >= ch.feedingTarget || ch.feedingAmount == 0) {
+						ch.pumpReturn = OK;
 					}
 					else {
-						// Increase feed cycles (checking for empty scale)
-						feedCycles++;
+						// Amount not yet reached, Pump still busy / ready for accurate feeding.
+						ch.pumpReturn = BUSY;
 					}
+
+					// Go to accurate feeding (will skip the actual steps if feeding amount is reached)
+					ch.feedMode = ACCURATE;
 				}
-			}
 
-			// Check if accu. amount is reached
-			if (pump1Return == OK) {
-				// Reset feed cycles, flags and go to accurate feeding.
-				feedCycles = 0;
-				pump1Return = BUSY;
-				feedMode = EMPTY;
-			}
+				// Check if approx. amount is not reached after 10 cycles
+				if (ch.feedCycles >= 10) {
+					ch.feedCycles = 0; // Reset feed cycles
+					// Switch to emergency feeding, since approx.
+					// amount is not reached after 10 cycles.
+					PackPushData('E', 99, 6); // 99 - no device, 6 - Empty or scale broken (Support Function)
+					Mode_c1 = EMGY;
+				}
+				break;
+				// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+			case ACCURATE:
+				// Accurate
+				// Move slider in a precise filling motion until the desired amount is reached.
+				// The small steps shrink with the missing amount (see FP3000::AccurateIncrement).
+
+				if (ch.pumpReturn == BUSY) {
+					if (pump.MoveCycleAccurate(ch.feedingTarget - ch.fed) != BUSY) {
+						ch.fed = pump.Measure(3);
+						if (ch.fed >= ch.feedingTarget) {
+							// Final amount reached, ready for final step (EMPTY).
+							ch.pumpReturn = OK;
+						}
+						else {
+							// Increase feed cycles (checking for empty scale)
+							ch.feedCycles++;
+						}
+					}
+				}
 
-			// Check if accu. amount is not reached after 100 cycles (at least one pump)
-			if (feedCycles >= 100) {
-				feedCycles = 0; // Reset feed cycles
-				// Switch to emergency feeding.
-				PackPushData('E', 99, 6); // 99 - no device, 6 - Empty or scale broken (Support Function)
-				Mode_c1 = EMGY;
-			}
+				// Check if accu. amount is reached
+				if (ch.pumpReturn == OK) {
+					// Reset feed cycles, flags and go to accurate feeding.
+					ch.feedCycles = 0;
+					ch.pumpReturn = BUSY;
+					ch.feedMode = EMPTY;
+				}
 
-			break;
-			// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+				// Check if accu. amount is not reached after 100 cycles
+				if (ch.feedCycles >= 100) {
+					ch.feedCycles = 0; // Reset feed cycles
+					// Switch to emergency feeding.
+					PackPushData('E', 99, 6); // 99 - no device, 6 - Empty or scale broken (Support Function)
+					Mode_c1 = EMGY;
+				}
 
-		case EMPTY:
-			// Return slider back to home position, do final measurement, then empty the scales.
+				break;
+				// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-			// Pump 1
-			if (pump1Return == BUSY) {
-				// Move to home position
-				if (Pump_1.MoveTo(0)) {
+			case EMPTY:
+				// Do final measurement, then return slider back to home position (the dumper empties the scales below).
 
-					// Do Final Measurement and send data to Core 0
-					lastFed_1 = Pump_1.Measure(7);
+				// Final Measurement (slider is still at rest) and send data to Core 0
+				if (!ch.finalMeasured) {
+					ch.lastFed = pump.Measure(7);
 					// (Uses floatToUint16 to convert measured float to uint16_t)
-					PackPushData('A', SCALE_1, floatToUint16(lastFed_1));		// (Support Function)
+					PackPushData('A', channelConfig[c].scale, floatToUint16(ch.lastFed));	// (Support Function)
+
+					// Learn grams per step and accuracy from this feeding, report the accuracy
+					// (not if this channel had nothing to feed, e.g. a cat skipped at this time)
+					if (ch.feedingAmount > 0) {
+						pump.LearnDose(ch.lastFed);
+						pump.LearnAccuracy(ch.feedingTarget, ch.lastFed);
+						if (!pump.SaveDoseModel()) {
+							ReceiveWarningsErrors_c1(pump, channelConfig[c].motor);		// (Support Function)
+						}
+						ReportAccuracy_c1(pump, channelConfig[c].scale);				// (Support Function)
+					}
 
-					// Set correction for next feeding
-					feedingCorrection_1 = feedingAmount_1 - lastFed_1;
+					ch.finalMeasured = true;
+				}
 
-					// Pump 1 is ready for emptying.
-					pump1Return = OK;
+				// Move to home position
+				if (ch.pumpReturn == BUSY && pump.MoveTo(0)) {
+					ch.pumpReturn = OK;
 				}
+				break;
+			}
+		}
+		// +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+
+		// EMPTY (all channels)
+		{
+			bool measured = (Mode_c1 == FEED);
+			bool home = true;
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				measured = measured && channel[c].finalMeasured;
+				home = home && channel[c].feedMode == EMPTY && channel[c].pumpReturn == OK;
 			}
 
-			// Empty Scale if pumps is ready
-			if (pump1Return == OK) {
-				if (DumperDrive.EmptyScale() != BUSY) {
+			// Empty Scales (while the pumps return), once all channels are measured
+			if (measured && dumperReturn == BUSY) {
+				dumperReturn = DumperDrive.EmptyScale();
+			}
+
+			// Check if all are finished
+			if (home && dumperReturn != BUSY) {
 
-					// Reset flags, check for errors and go to IDLE.
-					pump1Return = BUSY;
+				// Reset flags, check for errors and go to IDLE.
+				float lastFed = 0;
+				dumperReturn = BUSY;
+				for (byte c = 0; c < FEED_CHANNELS; c++) {
+					channel[c].feedMode = PRIME;
+					channel[c].pumpReturn = BUSY;
+					channel[c].finalMeasured = false;
+					lastFed = max(lastFed, channel[c].lastFed);
+				}
 
-					// Update Food Level
-					checkFillLevel_c1(floatToUint16(lastFed_1 / 100)); // (Support Function)
+				// Update Food Level
+				checkFillLevel_c1(floatToUint16(lastFed / 100)); // (Support Function)
 
-					// Check for warnings and errors
-					ReceiveWarningsErrors_c1(DumperDrive, MOTOR_0);				// (Support Function)
-					ReceiveWarningsErrors_c1(Pump_1, MOTOR_1);					// (Support Function)
+				// Report step timing quality of the last moves (compare STEP_MODE 0 vs. 1)
+				PackPushData('J', MOTOR_0, DumperDrive.StepJitter());					// (Support Function)
+				ReportStepTiming_c1(DumperDrive, MOTOR_0);								// (Support Function)
+				for (byte c = 0; c < FEED_CHANNELS; c++) {
+					PackPushData('J', channelConfig[c].motor, Pumps[c].StepJitter());	// (Support Function)
+					ReportStepTiming_c1(Pumps[c], channelConfig[c].motor);				// (Support Function)
+				}
 
-					Mode_c1 = IDLE; // Back to IDLE
+				// Check for warnings and errors
+				ReceiveWarningsErrors_c1(DumperDrive, MOTOR_0);							// (Support Function)
+				for (byte c = 0; c < FEED_CHANNELS; c++) {
+					ReceiveWarningsErrors_c1(Pumps[c], channelConfig[c].motor);			// (Support Function)
 				}
+
+				Mode_c1 = IDLE; // Back to IDLE
 			}
-			break;
-			// ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*
 		}
 		break;
 		// ----------------------------------------------------------------------------------------------------
@@ -552,20 +767,23 @@ void loop1() {
 		// 5 - FINISHED
 		// 6 - CALIBRATION_ERROR
 		// -------------------------
-		// Calibrate Scale 1
-		while (calStatus < 5) { // 5 = Calibration successful			
-			// Calibrate
-			calStatus = Pump_1.CalibrateScale(false);
-			// Send calibration updates to Core 0.
-			if (prevCalStatus != calStatus) {
-				PackPushData('C', 1, calStatus);								// (Support Function)
-				prevCalStatus = calStatus;
+		// Calibrate Scales (one after the other)
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			while (calStatus < 5) { // 5 = Calibration successful			
+				// Calibrate
+				calStatus = Pumps[c].CalibrateScale(false);
+				// Send calibration updates to Core 0.
+				if (prevCalStatus != calStatus) {
+					PackPushData('C', c + 1, calStatus);						// (Support Function)
+					prevCalStatus = calStatus;
+				}
+				// (No need to implement error handling here, as it should be user detecable.)
 			}
-			// (No need to implement error handling here, as it should be user detecable.)
-		}
 
-		// Reset CalStatus
-		calStatus = 0;
+			// Reset CalStatus
+			calStatus = 0;
+			prevCalStatus = 1;
+		}
 
 		// Back to IDLE
 		Mode_c1 = IDLE;
@@ -600,16 +818,22 @@ void loop1() {
 
 		// Dumper Drive (Scales)
 		while (DumperDrive.HomeMotor() == BUSY);
-		DumperDrive.AutotuneStall(true, true);
+		while (DumperDrive.AutotuneStall(true, true) == BUSY);
 		ReceiveWarningsErrors_c1(DumperDrive, MOTOR_0);				// (Support Function)
 
-		// Pump 1
-		while (Pump_1.HomeMotor() == BUSY);
-		Pump_1.AutotuneStall(true, true);
-		ReceiveWarningsErrors_c1(Pump_1, MOTOR_1);					// (Support Function)
+		// Pumps
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			while (Pumps[c].HomeMotor() == BUSY);
+			while (Pumps[c].AutotuneStall(true, true) == BUSY);
+			ReceiveWarningsErrors_c1(Pumps[c], channelConfig[c].motor);	// (Support Function)
+		}
 
 		// Turn off power
 		Power_c1(false);											// (Support Function)
+		DumperDrive.InvalidatePosition();
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			Pumps[c].InvalidatePosition();
+		}
 
 
 		// Reboot PurrPleaser
@@ -635,22 +859,51 @@ void loop1() {
 		// NOTE, EmergencyMove() expects the cycles to be set. This
 		// defines roughly the amount of food to be dispensed.
 		// NOTE, the default stepper speed will be halfed automatically.
-		// NOTE, this is blocking code.
+		// NOTE, all motors move at the same time (non-blocking).
 		// ===============================================================
 
 		// Turn on power
 		Power_c1(true);												// (Support Function)
 
 		// Emergency Move
-		DumperDrive.EmergencyMove(EMGY_CURRENT, EMGY_CYCLES);
-		Pump_1.EmergencyMove(EMGY_CURRENT, EMGY_CYCLES);
+		{
+			static byte dumperEmgy = BUSY;
+			static byte pumpEmgy[FEED_CHANNELS] = {};
+			bool moving = false;
+			if (dumperEmgy == BUSY) {
+				dumperEmgy = DumperDrive.EmergencyMove(EMGY_CURRENT, EMGY_CYCLES);
+				moving = moving || dumperEmgy == BUSY;
+			}
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				if (pumpEmgy[c] == BUSY) {
+					pumpEmgy[c] = Pumps[c].EmergencyMove(EMGY_CURRENT, EMGY_CYCLES);
+					moving = moving || pumpEmgy[c] == BUSY;
+				}
+			}
+			if (moving) {
+				break;
+			}
+			dumperEmgy = BUSY;
+			for (byte c = 0; c < FEED_CHANNELS; c++) {
+				pumpEmgy[c] = BUSY;
+			}
+		}
 
 		// Turn off power
 		Power_c1(false);											// (Support Function)
+		DumperDrive.InvalidatePosition();
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			Pumps[c].InvalidatePosition();
+		}
 
 		// Reset Flags
 		dumperReturn = BUSY;
-		pump1Return = BUSY;
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			channel[c].feedMode = PRIME;
+			channel[c].pumpReturn = BUSY;
+			channel[c].finalMeasured = false;
+			channel[c].feedCycles = 0;
+		}
 
 		// Back to IDLE
 		Mode_c1 = IDLE;
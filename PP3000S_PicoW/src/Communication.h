@@ -50,53 +50,6 @@ HASensor HAInfo("Debug");
 HASensor HAFill("Filling");
 HASwitch HAStall("Stall_Warning");
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-// Scale Sensors
-HASensorNumber HAScale1("Scale_1");
-HASensorNumber HAScale2("Scale_2");
-
-// Feeding Amount Sensors for Each Cat
-HANumber HAFeedingAmountCat1("Daily_Cat_1");
-HANumber HAFeedingAmountCat2("Daily_Cat_2");
-
-// Feeding Time Numbers
-HANumber HAFeedingHour1("Hour_1");
-HANumber HAFeedingMin1("Min_1");
-HANumber HAFeedingHour2("Hour_2");
-HANumber HAFeedingMin2("Min_2");
-HANumber HAFeedingHour3("Hour_3");
-HANumber HAFeedingMin3("Min_3");
-HANumber HAFeedingHour4("Hour_4");
-HANumber HAFeedingMin4("Min_4");
-
-// Feeding Amounts per Time for Cat 1
-HANumber HAFeedingAmountCat1Time1("Cat1_Time1");
-HANumber HAFeedingAmountCat1Time2("Cat1_Time2");
-HANumber HAFeedingAmountCat1Time3("Cat1_Time3");
-HANumber HAFeedingAmountCat1Time4("Cat1_Time4");
-
-// Feeding Amounts per Time for Cat 2
-HANumber HAFeedingAmountCat2Time1("Cat2_Time1");
-HANumber HAFeedingAmountCat2Time2("Cat2_Time2");
-HANumber HAFeedingAmountCat2Time3("Cat2_Time3");
-HANumber HAFeedingAmountCat2Time4("Cat2_Time4");
-
-// Treat Amounts
-HANumber HATreatAmount1("Cat1_Treat_Amount");
-HANumber HATreatAmount2("Cat2_Treat_Amount");
-
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-// Scale Sensors
-HASensorNumber HAScale1("Scale_1");
-
-// Feeding Amount Sensors for Each Cat
-HANumber HAFeedingAmountCat1("Daily_Cat_1");
-
 // Feeding Time Numbers
 HANumber HAFeedingHour1("Hour_1");
 HANumber HAFeedingMin1("Min_1");
@@ -107,17 +60,41 @@ HANumber HAFeedingMin3("Min_3");
 HANumber HAFeedingHour4("Hour_4");
 HANumber HAFeedingMin4("Min_4");
 
-// Feeding Amounts per Time
-HANumber HAFeedingAmountCat1Time1("Cat1_Time1");
-HANumber HAFeedingAmountCat1Time2("Cat1_Time2");
-HANumber HAFeedingAmountCat1Time3("Cat1_Time3");
-HANumber HAFeedingAmountCat1Time4("Cat1_Time4");
-
-// Treat Amounts
-HANumber HATreatAmount1("Cat1_Treat_Amount");
-
+// Cat Entities (one set per feeding channel, see FEED_CHANNELS)
+struct HACatEntities {
+    HASensorNumber scale;       // Last amount
+    HANumber daily;             // Daily feeding amount
+    HANumber amountAt[4];       // Feeding amount per feeding time
+    HANumber treat;             // Treat amount
+};
+#define HA_CAT_ENTITIES(n) { HASensorNumber("Scale_" #n), HANumber("Daily_Cat_" #n), \
+    { HANumber("Cat" #n "_Time1"), HANumber("Cat" #n "_Time2"), HANumber("Cat" #n "_Time3"), HANumber("Cat" #n "_Time4") }, \
+    HANumber("Cat" #n "_Treat_Amount") }
+
+HACatEntities HACat[FEED_CHANNELS] = {
+    HA_CAT_ENTITIES(1),
+#if FEED_CHANNELS > 1
+    HA_CAT_ENTITIES(2),
 #endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++
+};
+
+// Names of the Cat Entities (as shown at Home Assistant)
+struct HACatNames {
+    const char* scale;
+    const char* daily;
+    const char* amountAt[4];
+    const char* treat;
+};
+#define HA_CAT_NAMES(name) { "Last amount " name, "Daily " name, \
+    { "Amount " name "@Time 1", "Amount " name "@Time 2", "Amount " name "@Time 3", "Amount " name "@Time 4" }, \
+    "Treat Amount " name }
+
+const HACatNames HACatName[FEED_CHANNELS] = {
+    HA_CAT_NAMES(NAME_CAT_1),
+#if FEED_CHANNELS > 1
+    HA_CAT_NAMES(NAME_CAT_2),
+#endif
+};
 
 // --------------------------------------------------------------------------------------------*
 // END OF HOME ASSISTANT SPECIFICS++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -202,66 +179,25 @@ void setupCommunication_c0() {
     HAFill.setIcon("mdi:gauge");
     HAFill.setName("Days until empty");
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-    // Scale Sensors
-    HAScale1.setIcon("mdi:scale");
-    HAScale1.setName("Last amount " NAME_CAT_1);
-    HAScale1.setDeviceClass("weight");
-    HAScale1.setUnitOfMeasurement("g");
-    HAScale2.setIcon("mdi:scale");
-    HAScale2.setName("Last amount " NAME_CAT_2);
-    HAScale2.setDeviceClass("weight");
-    HAScale2.setUnitOfMeasurement("g");
-
-    // Daily Feeding Amount for Each Cat
+    // Scale Sensors and Daily Feeding Amount for Each Cat
     // =========================================================================================
-    // Cat 1
-    HAFeedingAmountCat1.setIcon("mdi:weight");
-    HAFeedingAmountCat1.setName("Daily " NAME_CAT_1);
-    HAFeedingAmountCat1.setDeviceClass("weight");
-    HAFeedingAmountCat1.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1.setMin(MIN_DAILY);
-    HAFeedingAmountCat1.setMax(MAX_DAILY);
-    HAFeedingAmountCat1.setStep(1);
-    HAFeedingAmountCat1.onCommand(UpdateFeedingAmounts_c0);
-    // Cat 2
-    HAFeedingAmountCat2.setIcon("mdi:weight");
-    HAFeedingAmountCat2.setName("Daily " NAME_CAT_2);
-    HAFeedingAmountCat2.setDeviceClass("weight");
-    HAFeedingAmountCat1.setUnitOfMeasurement("g");
-    HAFeedingAmountCat2.setMin(MIN_DAILY);
-	HAFeedingAmountCat2.setMax(MAX_DAILY);
-    HAFeedingAmountCat2.setStep(1);
-    HAFeedingAmountCat2.onCommand(UpdateFeedingAmounts_c0);
-	// =========================================================================================
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-    // Scale Sensors
-    HAScale1.setIcon("mdi:scale");
-    HAScale1.setName("Last amount " NAME_CAT_1);
-    HAScale1.setDeviceClass("weight");
-    HAScale1.setUnitOfMeasurement("g");
-
-    // Daily Feeding Amount
-    // =========================================================================================
-    HAFeedingAmountCat1.setIcon("mdi:weight");
-    HAFeedingAmountCat1.setName("Daily " NAME_CAT_1);
-    HAFeedingAmountCat1.setDeviceClass("weight");
-    HAFeedingAmountCat1.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1.setMin(MIN_DAILY);
-    HAFeedingAmountCat1.setMax(MAX_DAILY);
-    HAFeedingAmountCat1.setStep(1);
-    HAFeedingAmountCat1.onCommand(UpdateFeedingAmounts_c0);
+    for (byte c = 0; c < FEED_CHANNELS; c++) {
+        HACat[c].scale.setIcon("mdi:scale");
+        HACat[c].scale.setName(HACatName[c].scale);
+        HACat[c].scale.setDeviceClass("weight");
+        HACat[c].scale.setUnitOfMeasurement("g");
+
+        HACat[c].daily.setIcon("mdi:weight");
+        HACat[c].daily.setName(HACatName[c].daily);
+        HACat[c].daily.setDeviceClass("weight");
+        HACat[c].daily.setUnitOfMeasurement("g");
+        HACat[c].daily.setMin(MIN_DAILY);
+        HACat[c].daily.setMax(MAX_DAILY);
+        HACat[c].daily.setStep(1);
+        HACat[c].daily.onCommand(UpdateFeedingAmounts_c0);
+    }
     // =========================================================================================
 
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++
-// --------------------------------------------------------------------------------------------*
-
     // Feeding Time Numbers
     // First Feeding Time
     // =========================================================================================
@@ -341,124 +277,32 @@ void setupCommunication_c0() {
 	// =========================================================================================
 
 
-    // Feeding Amounts per Time for Cat 1
+    // Feeding Amounts per Time and Treat Amounts for Each Cat
     // =========================================================================================
-    // Time 1
-    HAFeedingAmountCat1Time1.setIcon("mdi:weight");
-    HAFeedingAmountCat1Time1.setName("Amount " NAME_CAT_1 "@Time 1");
-    HAFeedingAmountCat1Time1.setDeviceClass("weight");
-	HAFeedingAmountCat1Time1.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1Time1.setMin(MIN_SINGLE);
-	HAFeedingAmountCat1Time1.setMax(MAX_SINGLE);
-    HAFeedingAmountCat1Time1.setStep(1);
-    HAFeedingAmountCat1Time1.onCommand(UpdateFeedingAmounts_c0);
-	// Time 2
-    HAFeedingAmountCat1Time2.setIcon("mdi:weight");
-    HAFeedingAmountCat1Time2.setName("Amount " NAME_CAT_1 "@Time 2");
-    HAFeedingAmountCat1Time2.setDeviceClass("weight");
-	HAFeedingAmountCat1Time2.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1Time2.setMin(MIN_SINGLE);
-	HAFeedingAmountCat1Time2.setMax(MAX_SINGLE);
-    HAFeedingAmountCat1Time2.setStep(1);
-    HAFeedingAmountCat1Time2.onCommand(UpdateFeedingAmounts_c0);
-	// Time 3
-    HAFeedingAmountCat1Time3.setIcon("mdi:weight");
-    HAFeedingAmountCat1Time3.setName("Amount " NAME_CAT_1 "@Time 3");
-    HAFeedingAmountCat1Time3.setDeviceClass("weight");
-	HAFeedingAmountCat1Time3.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1Time3.setMin(MIN_SINGLE);
-	HAFeedingAmountCat1Time3.setMax(MAX_SINGLE);
-    HAFeedingAmountCat1Time3.setStep(1);
-    HAFeedingAmountCat1Time3.onCommand(UpdateFeedingAmounts_c0);
-	// Time 4
-    HAFeedingAmountCat1Time4.setIcon("mdi:weight");
-    HAFeedingAmountCat1Time4.setName("Amount " NAME_CAT_1 "@Time 4");
-    HAFeedingAmountCat1Time4.setDeviceClass("weight");
-	HAFeedingAmountCat1Time4.setUnitOfMeasurement("g");
-    HAFeedingAmountCat1Time4.setMin(MIN_SINGLE);
-	HAFeedingAmountCat1Time4.setMax(MAX_SINGLE);
-    HAFeedingAmountCat1Time4.setStep(1);
-    HAFeedingAmountCat1Time4.onCommand(UpdateFeedingAmounts_c0);
-	// =========================================================================================
-
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-    // Feeding Amounts per Time for Cat 2
-    // =========================================================================================
-    // Time 1
-    HAFeedingAmountCat2Time1.setIcon("mdi:weight");
-    HAFeedingAmountCat2Time1.setName("Amount " NAME_CAT_2 "@Time 1");
-    HAFeedingAmountCat2Time1.setDeviceClass("weight");
-	HAFeedingAmountCat2Time1.setUnitOfMeasurement("g");
-    HAFeedingAmountCat2Time1.setMin(MIN_SINGLE);
-	HAFeedingAmountCat2Time1.setMax(MAX_SINGLE);
-    HAFeedingAmountCat2Time1.setStep(1);
-	HAFeedingAmountCat2Time1.onCommand(UpdateFeedingAmounts_c0);
-    // Time 2
-    HAFeedingAmountCat2Time2.setIcon("mdi:weight");
-    HAFeedingAmountCat2Time2.setName("Amount " NAME_CAT_2 "@Time 2");
-    HAFeedingAmountCat2Time2.setDeviceClass("weight");
-    HAFeedingAmountCat2Time2.setUnitOfMeasurement("g");
-    HAFeedingAmountCat2Time2.setMin(MIN_SINGLE);
-	HAFeedingAmountCat2Time2.setMax(MAX_SINGLE);
-    HAFeedingAmountCat2Time2.setStep(1);
-	HAFeedingAmountCat2Time2.onCommand(UpdateFeedingAmounts_c0);
-    // Time 3
-    HAFeedingAmountCat2Time3.setIcon("mdi:weight");
-    HAFeedingAmountCat2Time3.setName("Amount " NAME_CAT_2 "@Time 3");
-    HAFeedingAmountCat2Time3.setDeviceClass("weight");
-	HAFeedingAmountCat2Time3.setUnitOfMeasurement("g");
-    HAFeedingAmountCat2Time3.setMin(MIN_SINGLE);
-	HAFeedingAmountCat2Time3.setMax(MAX_SINGLE);
-    HAFeedingAmountCat2Time3.setStep(1);
-	HAFeedingAmountCat2Time3.onCommand(UpdateFeedingAmounts_c0);
-    // Time 4
-    HAFeedingAmountCat2Time4.setIcon("mdi:weight");
-    HAFeedingAmountCat2Time4.setName("Amount " NAME_CAT_2 "@Time 4");
-    HAFeedingAmountCat2Time4.setDeviceClass("weight");
-	HAFeedingAmountCat2Time4.setUnitOfMeasurement("g");
-    HAFeedingAmountCat2Time4.setMin(MIN_SINGLE);
-	HAFeedingAmountCat2Time4.setMax(MAX_SINGLE);
-    HAFeedingAmountCat2Time4.setStep(1);
-	HAFeedingAmountCat2Time4.onCommand(UpdateFeedingAmounts_c0);
-
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++
-// --------------------------------------------------------------------------------------------*
+    for (byte c = 0; c < FEED_CHANNELS; c++) {
+        for (byte t = 0; t < 4; t++) {
+            HACat[c].amountAt[t].setIcon("mdi:weight");
+            HACat[c].amountAt[t].setName(HACatName[c].amountAt[t]);
+            HACat[c].amountAt[t].setDeviceClass("weight");
+            HACat[c].amountAt[t].setUnitOfMeasurement("g");
+            HACat[c].amountAt[t].setMin(MIN_SINGLE);
+            HACat[c].amountAt[t].setMax(MAX_SINGLE);
+            HACat[c].amountAt[t].setStep(1);
+            HACat[c].amountAt[t].onCommand(UpdateFeedingAmounts_c0);
+        }
 
-    // =========================================================================================
-       
-    // Treat Amounts
-    // =========================================================================================
-    // Cat 1
-    HATreatAmount1.setIcon("mdi:candy");
-    HATreatAmount1.setName("Treat Amount " NAME_CAT_1);
-    HATreatAmount1.setDeviceClass("weight");
-    HATreatAmount1.setUnitOfMeasurement("g");
-    HATreatAmount1.setMin(MIN_SINGLE);
-    HATreatAmount1.setMax(MAX_SINGLE);
-    HATreatAmount1.setStep(1);
-    HATreatAmount1.onCommand(UpdateTreatAmounts_c0);
-
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-    // Cat 2
-    HATreatAmount2.setIcon("mdi:candy");
-    HATreatAmount2.setName("Treat Amount " NAME_CAT_2);
-    HATreatAmount2.setDeviceClass("weight");
-    HATreatAmount2.setUnitOfMeasurement("g");
-    HATreatAmount2.setMin(MIN_SINGLE);
-    HATreatAmount2.setMax(MAX_SINGLE);
-    HATreatAmount2.setStep(1);
-    HATreatAmount2.onCommand(UpdateTreatAmounts_c0);
+        HACat[c].treat.setIcon("mdi:candy");
+        HACat[c].treat.setName(HACatName[c].treat);
+        HACat[c].treat.setDeviceClass("weight");
+        HACat[c].treat.setUnitOfMeasurement("g");
+        HACat[c].treat.setMin(MIN_SINGLE);
+        HACat[c].treat.setMax(MAX_SINGLE);
+        HACat[c].treat.setStep(1);
+        HACat[c].treat.onCommand(UpdateTreatAmounts_c0);
+        treatAmount[c] = TREAT_AMT;
+    }
     // =========================================================================================
 
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++
-// --------------------------------------------------------------------------------------------*
-
     // Setup MQTT
     mqtt.begin(MQTT_BROKER, MQTT_PORT, MQTT_USER, MQTT_PASSWD);
 
@@ -480,14 +324,9 @@ void TreatCats_c0(HAButton* sender) {
     DefaultInfo_c0(true);       // (Support Function)
 
     // Feed the cats
-    PackPushData('F', SCALE_1, floatToUint16(treatAmount1));
-
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-
-    PackPushData('F', SCALE_2, floatToUint16(treatAmount2));
-#endif
-// +++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++
+    for (byte c = 0; c < FEED_CHANNELS; c++) {
+        PackPushData('F', channelConfig[c].scale, floatToUint16(treatAmount[c]));
+    }
 }
 // --------------------------------------------------------------------------------------------*
 
@@ -527,52 +366,20 @@ void UpdateFeedingAmounts_c0(HANumeric number, HANumber* sender) {
         return;
     }
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-
-    // Define a mapping from sender pointers to feeding amounts indices
-    std::map<HANumber*, std::pair<int, int>> senderToIndexMap = {
-        {&HAFeedingAmountCat1, {-1, 0}},
-        {&HAFeedingAmountCat2, {-1, 1}},
-        {&HAFeedingAmountCat1Time1, {0, 0}},
-        {&HAFeedingAmountCat1Time2, {1, 0}},
-        {&HAFeedingAmountCat1Time3, {2, 0}},
-        {&HAFeedingAmountCat1Time4, {3, 0}},
-        {&HAFeedingAmountCat2Time1, {0, 1}},
-        {&HAFeedingAmountCat2Time2, {1, 1}},
-        {&HAFeedingAmountCat2Time3, {2, 1}},
-        {&HAFeedingAmountCat2Time4, {3, 1}}
-    };
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-    // Define a mapping from sender pointers to feeding amounts indices
-    std::map<HANumber*, std::pair<int, int>> senderToIndexMap = {
-		{&HAFeedingAmountCat1, {-1, 0}},
-		{&HAFeedingAmountCat1Time1, {0, 0}},
-		{&HAFeedingAmountCat1Time2, {1, 0}},
-		{&HAFeedingAmountCat1Time3, {2, 0}},
-		{&HAFeedingAmountCat1Time4, {3, 0}}
-	};
-
-#endif
-// +++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++
-
-    auto it = senderToIndexMap.find(sender);
-    if (it != senderToIndexMap.end()) {
-        auto [timeIndex, catIndex] = it->second;
-        if (timeIndex == -1) { // Special case for daily feeding amounts
-            // Set the feeding amounts for the selected cat (if "0" nothing is changed)
-            if(catIndex == 0) {
-				PicoRTC.setFeedingAmounts(newAmount, noChange);
-			}
-			else if(catIndex == 1) {
-				PicoRTC.setFeedingAmounts(noChange, newAmount);
-			}
-            DEBUG_DEBUG("New daily feeding amount for cat %d: %d", catIndex + 1, newAmount);
+    // Find the cat (and feeding time) of the sender
+    for (byte c = 0; c < FEED_CHANNELS; c++) {
+        if (sender == &HACat[c].daily) {
+            // Set the daily feeding amount of this cat (if "0" nothing is changed)
+            byte amounts[2] = { noChange, noChange };
+            amounts[c] = newAmount;
+            PicoRTC.setFeedingAmounts(amounts[0], amounts[1]);
+            DEBUG_DEBUG("New daily feeding amount for cat %d: %d", c + 1, newAmount);
         }
-        else {
-            PicoRTC.schedule.feedingAmounts[timeIndex][catIndex] = newAmount;
-            DEBUG_DEBUG("New feeding amount for cat %d at time %d: %d", catIndex + 1, timeIndex + 1, newAmount);
+        for (byte t = 0; t < 4; t++) {
+            if (sender == &HACat[c].amountAt[t]) {
+                PicoRTC.schedule.feedingAmounts[t][c] = newAmount;
+                DEBUG_DEBUG("New feeding amount for cat %d at time %d: %d", c + 1, t + 1, newAmount);
+            }
         }
     }
 
@@ -649,16 +456,11 @@ void UpdateTreatAmounts_c0(HANumeric number, HANumber* sender) {
 	}
 
 	// Save the new treat amount
-    if (sender == &HATreatAmount1) {
-		treatAmount1 = newAmount;
-	}
-// ++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-	else if (sender == &HATreatAmount2) {
-		treatAmount2 = newAmount;
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		if (sender == &HACat[c].treat) {
+			treatAmount[c] = newAmount;
+		}
 	}
-#endif
-// +++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++
 
 	// Report the selected option back to HA
 	sender->setState(number);
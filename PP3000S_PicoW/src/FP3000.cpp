@@ -22,6 +22,39 @@
 #include "Arduino.h"
 #include "FP3000.h"
 
+// VACTUAL mode (TMC2209 internal pulse generator): VACTUAL per step/s (2^24 / 12MHz internal clock), update interval of
+// the velocity (us) and how far (share of std_distance) a return stroke may pass home before the endstop counts as missed
+#define VACTUAL_PER_STEP_RATE	1.398101
+#define VACTUAL_UPDATE_US		2000
+#define VACTUAL_OVERRUN			0.1
+
+// Adaptive stroke speed (see SetAdaptiveSpeed): interval of the load readings (ms), part of the stroke they are taken in,
+// load margins (SG_RESULT / stall threshold) to raise / lower the speed, speed factors and the lowest speed (share of the speed)
+#define LOAD_SAMPLE_MS			10
+#define LOAD_SAMPLE_FROM		0.2
+#define LOAD_SAMPLE_TO			0.8
+#define LOAD_MARGIN_HIGH		3.0
+#define LOAD_MARGIN_LOW			1.5
+#define STROKE_SPEED_UP			1.1
+#define STROKE_SPEED_DOWN		0.8
+#define STROKE_SPEED_MIN		0.5
+
+// Dosing model (see PlanDose): weight of a new feeding in the learned grams per step (0..1, higher = adapts faster)
+#define DOSE_LEARN_RATE			0.3
+
+// Accurate filling (see AccurateIncrement): share of the missing grams a small step should dispense, largest small step (share
+// of std_distance)
+#define ACCURATE_AIM			0.5
+#define ACCURATE_MAX_STEP		0.1
+
+// Dosing accuracy (see LearnAccuracy): weight of a new feeding in bias and variance, feedings before the offsets adapt,
+// standard deviations an offset keeps from the desired amount and its limits (share of the configured offset)
+#define ACCURACY_RATE			0.2
+#define ACCURACY_MIN_FEEDINGS	5
+#define ACCURACY_SIGMAS			2.0
+#define ACCURACY_OFFSET_MIN		0.25
+#define ACCURACY_OFFSET_MAX		2.0
+
 
 // SETUP FUNCTIONS
 
@@ -54,15 +87,49 @@ FP3000::FP3000(byte MotorNumber, long std_distance, long max_range, long dir_hom
 
 	// Flags / Variables
 	startTime = 0;							// Timer for delays
+	homingStart = 0;
+	homingDuration = 0;
 	scaleCal = 3145.0;						// Scale calibration value (def. for 500g scale: 3145.0)
 	reduceStall = false;					// Flag to reduce stall value
+	emptyQueued = false;					// Flag for queued EmptyScale() motion
+	positionKnown = false;					// Position unknown until homed
+	managingError = false;					// Flag for ManageError() in progress
+	motorMove = 0;
+	emergencyLeg = 0;
+	autotuneState = TUNE_SETUP;
+	lastRecoveryProgress = 0;
+	_motion_profile = SpeedyStepper4Purr::PROFILE_TRAPEZOID;	// Feeding moves with constant acceleration (see SetSCurve)
+	_use_vactual = false;					// Coarse moves with STEP/DIR (see SetVactualMoves)
+	_stepper_accel = 0;						// Set in SetupMotor()
+	_mic_steps = 0;							// Set in SetupMotor()
+	_fast_mic_steps = 0;					// Strokes at the normal microsteps (see SetFastMicrosteps)
+	_max_stroke_speed = 0;					// Strokes at the normal speed (see SetAdaptiveSpeed)
+	strokeSpeed = stepper_speed;
+	strokeAway = false;
+	strokeMinLoad = 0xFFFF;
+	lastLoadSample = 0;
+	strokeWeightSum = 0;
+	strokeWeightCount = 0;
+	gramsPerStep = 0;						// Nothing learned yet (see PlanDose)
+	doseSteps = 0;
+	accurateIncrement = 0;
+	accurateTarget = 0;
+	accurateMoving = false;
+	accurateStartMissing = -1;				// Set by the first small step of a feeding (see AccurateIncrement)
+	accurateSteps = 0;
+	doseBias = 0;							// No feedings yet (see LearnAccuracy)
+	doseVariance = 0;
+	doseFeedings = 0;
+	vactualRunning = false;
+	vactualHoming = false;
+	vactualValue = 0;
 
 }
 
 // Setup Motor (BLOCKING)
 // Returns 1 if successful, 2 for error and 3 for warning.
 byte FP3000::SetupMotor(uint16_t motor_current, uint16_t mic_steps, uint32_t tcool,
-	byte step_pin, byte dir_pin, byte limit_pin, byte diag_pin, float stepper_accel) {
+	byte step_pin, byte dir_pin, byte limit_pin, byte diag_pin, float stepper_accel, byte step_mode, bool fixed_ramp) {
 
 	// Set Up Driver
 	// (Check TMC2209Stepper.h for more details on the functions and settings)
@@ -76,6 +143,7 @@ byte FP3000::SetupMotor(uint16_t motor_current, uint16_t mic_steps, uint32_t tco
 	StepperDriver.rms_current(motor_current);	// Sets the current in milliamps.
 	StepperDriver.SGTHRS(_stall_val);			// Set the stall value from 0-255. Higher value will make it indicate a stall quicker.
 	StepperDriver.microsteps(mic_steps);		// Set microsteps.
+	_mic_steps = mic_steps;
 	StepperDriver.TCOOLTHRS(tcool);				// Min. speed for stall detection.
 	StepperDriver.TPWMTHRS(0);					// Disable StealthChop PWM.
 	StepperDriver.semin(0);						// Turn off CoolStep.
@@ -85,8 +153,11 @@ byte FP3000::SetupMotor(uint16_t motor_current, uint16_t mic_steps, uint32_t tco
 
 	// Set Up Stepper
 	StepperMotor.connectToPins(step_pin, dir_pin, limit_pin, diag_pin);
+	StepperMotor.setStepMode(step_mode);		// Polled (0), step timer (1) or PIO (2)
+	StepperMotor.setFixedPointRamp(fixed_ramp);	// Fixed point (true) or float (false) ramp math
 	StepperMotor.setSpeedInStepsPerSecond(_stepper_speed);
 	StepperMotor.setAccelerationInStepsPerSecondPerSecond(stepper_accel);
+	_stepper_accel = stepper_accel;
 
 	// Wait for homing to be done (BLOCKING)
 	byte motorResult = BUSY;
@@ -204,6 +275,17 @@ byte FP3000::SetupScale(uint8_t nvmAddress, uint8_t dataPin, uint8_t clockPin) {
 	Warning = SCALE_CALFILE;
 	}
 
+	// Read the learned grams per step and accuracy (no file = nothing learned yet, see PlanDose / LearnAccuracy)
+	sprintf(filename, "/dose_%d.bin", _nvmAddress);
+	file = LittleFS.open(filename, "r");
+	if (file) {
+		file.read((uint8_t*)&gramsPerStep, sizeof(gramsPerStep));
+		file.read((uint8_t*)&doseBias, sizeof(doseBias));
+		file.read((uint8_t*)&doseVariance, sizeof(doseVariance));
+		file.read((uint8_t*)&doseFeedings, sizeof(doseFeedings));
+		file.close();
+	}
+
 	// Stop file system
 	LittleFS.end();
 
@@ -257,27 +339,60 @@ void FP3000::MotorTest(bool moveUP) {
 }
 
 // Prime (Prepare for Feeding)
-byte FP3000::Prime() {
+byte FP3000::Prime(bool tareScale) {
 
 	// =================================================================================================================================
 	// This is to prime the motor and (if set) the scale:
 	// It will home the motor and (if set) tare the scale. The function will return: 0 - busy, 1 - success, 2 - error, 3 - warning.
+	// If the position is still known (see InvalidatePosition), the motor only returns home and the endstop is checked there, which
+	// is much faster than a full homing. If the endstop is not triggered at home, the motor is homed fully.
+	// NOTE, set tareScale to false if other motors are still moving (e.g. the dumper), then call TareScale() once they are at rest.
 	// ================================================================================================================================= 
 
-	// Variables
-
-
-	// Home Motor
-	primeStatus = HomeMotor();
+	// Quick check if the position is still known, else home motor
+	if (positionKnown && StepperMotor.getStallEventCount() == 0) {
+		SetMicrosteps(_mic_steps);	// Normal microsteps (e.g. after an interrupted MoveCycle)
+		if (!MoveTo(0)) {
+			return BUSY;
+		}
+		if (EndstopTriggered() && StepperMotor.getStallEventCount() == 0) {
+			primeStatus = OK;
+		}
+		else {
+			positionKnown = false;	// Not at the endstop, home fully (next call)
+			primeStatus = BUSY;
+		}
+	}
+	else {
+		primeStatus = HomeMotor();
+	}
 
 	// Check if homing is done to tare the scale (if set)
-	if (primeStatus == OK && iAmScale == true) {
-		Scale.tare(20);
+	if (primeStatus == OK && tareScale) {
+		TareScale();
 	}
 
 	return primeStatus;
 }
 
+// Invalidate Position
+// The position can't be trusted anymore (e.g. the driver was disabled and the motor turned freely), the next Prime() homes fully.
+// Stalls and errors do this already.
+void FP3000::InvalidatePosition() {
+	positionKnown = false;
+	accurateMoving = false;
+}
+
+// Tare Scale (if set) - BLOCKING
+void FP3000::TareScale() {
+	if (iAmScale == true) {
+		Scale.tare(20);
+	}
+	doseSteps = 0;
+	accurateStartMissing = -1;
+	accurateSteps = 0;
+}
+
 // Approximate Filling
 byte FP3000::MoveCycle() {
 
@@ -304,23 +419,68 @@ byte FP3000::MoveCycle() {
 	// Change direction if the target position has been reached
 	if (currentPosition == homePosition) {
 		setPosition = targetPosition;
+
+		// Strokes with fewer microsteps and the adapted speed (set before the cycle starts, the motor is at rest)
+		if (StepperMotor.motionComplete() && !vactualRunning) {
+			SetMicrosteps(_fast_mic_steps);
+			if (_max_stroke_speed > 0) {
+				StepperMotor.setSpeedInStepsPerSecond(strokeSpeed);
+			}
+			strokeAway = true;
+			strokeMinLoad = 0xFFFF;
+			strokeWeightSum = 0;
+			strokeWeightCount = 0;
+		}
 	}
 	else if (abs(currentPosition) >= abs(targetPosition)) {
 		setPosition = homePosition;
+		strokeAway = false;
+	}
+
+	// Read the load while pumping (away from home, at speed)
+	if (_max_stroke_speed > 0 && strokeAway && abs(currentPosition) >= abs(targetPosition) * LOAD_SAMPLE_FROM &&
+		abs(currentPosition) <= abs(targetPosition) * LOAD_SAMPLE_TO && millis() - lastLoadSample >= LOAD_SAMPLE_MS) {
+		lastLoadSample = millis();
+		uint16_t load = StepperDriver.SG_RESULT();
+		if (load < strokeMinLoad) {
+			strokeMinLoad = load;
+		}
 	}
 
-	// Move to position
-	bool moveResult = MoveTo(setPosition);
+	// Weigh while returning (second half, the food has dropped by then), see StrokeWeight()
+	// NOTE, only when the scale has a reading ready, so this does not wait for the scale.
+	if (iAmScale && !strokeAway && currentPosition != homePosition && abs(currentPosition) <= abs(targetPosition) * 0.5 &&
+		strokeWeightCount < 0xFFFF && Scale.is_ready()) {
+		strokeWeightSum += Scale.get_units(1);
+		strokeWeightCount++;
+	}
+
+	// Move to position (strokes in VACTUAL mode if set, see SetVactualMoves)
+	bool moveResult;
+	if (_use_vactual) {
+		moveResult = VactualMoveTo(setPosition);
+	}
+	else {
+		moveResult = MoveTo(setPosition);
+	}
 
 	// Update currentPosition and check if back home. 
 	// If so, return OK (one cyle finished) if there was no stall detected (WARNING).
 	currentPosition = StepperMotor.getCurrentPositionInSteps();
 	if (currentPosition == homePosition && moveResult){
-		if (StepperMotor.checkStall()) {
+		// Back to the normal microsteps and speed
+		SetMicrosteps(_mic_steps);
+		doseSteps += DoseStroke();
+		bool stalled = StepperMotor.checkStall();
+		bool slowerStrokes = AdaptStrokeSpeed(stalled);
+
+		if (stalled) {
 			// Sometimes autotune isn't perfect. Also, the pump may be new and still
 			// wearing in. This flags that stall should be reduced (will be done at next warning check from main loop).
-			reduceStall = true;
+			// With adaptive speed, the strokes get slower first.
+			reduceStall = !slowerStrokes;
 			Warning = STEPPER_STALL;
+			positionKnown = false;
 
 			return WARNING;
 		}
@@ -332,7 +492,7 @@ byte FP3000::MoveCycle() {
 }
 
 // Accurate Filling
-byte FP3000::MoveCycleAccurate() {
+byte FP3000::MoveCycleAccurate(float missing) {
 
 	// =================================================================================================================================
 	// This functions is to contintue feeding after the MoveCycle() function (approx feeding) has been called:
@@ -340,6 +500,9 @@ byte FP3000::MoveCycleAccurate() {
 	// stopping motion: moving a bit, stop, moving a bit, stop.., until the standard distance is reached. This is intended to only 
 	// dispense a small amount of food, which can be measured between movements. The function will return 0 while it is busy, 1 for OK
 	// after each movement and 3 for warning. The warning is only trigger in case a stall is detected during the movement.
+	// NOTE, the move to the pre-position already includes the first small step (no food is dispensed up to the pre-position, so there
+	// is nothing to measure there).
+	// The small step is 1% of std_distance, unless the missing grams are given: then it adapts to them (see AccurateIncrement()).
 	// WARNING, this function should only be called when the motor is homed! FP3000 cannot see e.g. if the motor has been turned off.
 	// =================================================================================================================================
 
@@ -349,33 +512,66 @@ byte FP3000::MoveCycleAccurate() {
 	long prePosition = (_std_distance * 0.5 * (-1) * _dir_home);	// Pre-position (50% of std_distance)
 	long targetPosition = (_std_distance * (-1) * _dir_home);
 
-	// Get current position
-	long currentPosition = StepperMotor.getCurrentPositionInSteps();
+	// Plan the next move once the last one was reported. The target is kept until then: with the step timer or the PIO a move
+	// can end between two calls (or between the checks of this call), it must not be taken for the start of a new one.
+	if (!accurateMoving) {
 
-	// If the motor is at the home position, move to the pre-position
-	if (currentPosition == homePosition) {
-		setPosition = prePosition;
-	}
-	// If the motor is at the pre-position, do the stopping motion
-	else if(abs(currentPosition) >= abs(prePosition) && abs(currentPosition) < abs(targetPosition)) {
-		setPosition = currentPosition + (_std_distance * 0.01 * (-1) * _dir_home);	// Move 1% of std_distance	
-	}
-	// If the motor is at the target position, move back home
-	else if (abs(currentPosition) >= abs(targetPosition)) {
-		setPosition = homePosition;
+		// A move from before (e.g. the return stroke of MoveCycle()) ends first
+		if (!StepperMotor.motionComplete()) {
+			StepperMotor.processMovement();
+			return BUSY;
+		}
+
+		// Small step and current position
+		long increment = (AccurateIncrement(missing) * (-1) * _dir_home);
+		long currentPosition = StepperMotor.getCurrentPositionInSteps();
+
+		// If the motor is at the home position, move to the pre-position and the first small step in one go (two segments in the
+		// same direction, the queue blends them into one move)
+		if (currentPosition == homePosition) {
+			setPosition = prePosition + increment;
+			SetMicrosteps(_mic_steps);		// Accurate phase always with the normal microsteps
+			StepperMotor.queueMoveInSteps(prePosition, 0, _motion_profile);
+			StepperMotor.queueMoveInSteps(setPosition, 0, _motion_profile);
+		}
+		// If the motor is at the pre-position, do the stopping motion (not beyond the standard distance)
+		else if(abs(currentPosition) >= abs(prePosition) && abs(currentPosition) < abs(targetPosition)) {
+			setPosition = currentPosition + increment;
+			if (abs(setPosition) > abs(targetPosition)) {
+				setPosition = targetPosition;
+			}
+		}
+		// If the motor is at the target position, move back home
+		else if (abs(currentPosition) >= abs(targetPosition)) {
+			setPosition = homePosition;
+		}
+
+		// Steps that dispense food (beyond the pre-position, not on the way back home)
+		accurateIncrement = 0;
+		if (setPosition != homePosition) {
+			accurateIncrement = abs(setPosition) - max(abs(currentPosition), abs(prePosition));
+		}
+		accurateTarget = setPosition;
+		accurateMoving = true;
 	}
 
 	// Command move to position
-	bool moveResult = MoveTo(setPosition);
+	bool moveResult = MoveTo(accurateTarget);
 
 	// Update currentPosition and check if move cylce is finished.
 	// If so, return OK (one cyle finished) if there was no stall detected (WARNING).
 	if (moveResult == true) {
+		accurateMoving = false;
+
+		// Count the small step for the dosing model and the step sizing
+		doseSteps += accurateIncrement;
+		accurateSteps += accurateIncrement;
 
 		if (StepperMotor.checkStall()) {
 			// Flag stall reduction request
 			reduceStall = true;
 			Warning = STEPPER_STALL;
+			positionKnown = false;
 			return WARNING;
 		}
 		else {
@@ -388,6 +584,92 @@ byte FP3000::MoveCycleAccurate() {
 
 }
 
+// Accurate Filling Step Size
+long FP3000::AccurateIncrement(float missing) {
+
+	// =================================================================================================================================
+	// This is to size the small step of MoveCycleAccurate() by the missing grams:
+	// The step should dispense ACCURATE_AIM of the missing grams, so it is large while far from the desired amount and shrinks
+	// towards it. The grams per step are the ones observed in this feeding (missing grams against accurate steps since the scale
+	// was tared), until then the learned ones (see LearnDose()). The step stays between 1% and ACCURATE_MAX_STEP of std_distance.
+	// Without the missing grams or grams per step, the step is 1% of std_distance.
+	// =================================================================================================================================
+
+	long minIncrement = _std_distance * 0.01;					// Small step (1% of std_distance)
+	long maxIncrement = _std_distance * ACCURATE_MAX_STEP;
+
+	if (missing < 0) {
+		return minIncrement;
+	}
+
+	// Missing grams before the first small step of this feeding
+	if (accurateStartMissing < 0) {
+		accurateStartMissing = missing;
+		accurateSteps = 0;
+	}
+
+	// Grams per step observed in this feeding, else the learned ones
+	float stepGrams = gramsPerStep;
+	if (accurateSteps > 0 && accurateStartMissing > missing) {
+		stepGrams = (accurateStartMissing - missing) / accurateSteps;
+	}
+	if (stepGrams <= 0) {
+		return minIncrement;
+	}
+
+	long increment = missing * ACCURATE_AIM / stepGrams;
+	if (increment < minIncrement) {
+		increment = minIncrement;
+	}
+	if (increment > maxIncrement) {
+		increment = maxIncrement;
+	}
+	return increment;
+}
+
+// Planned Filling
+byte FP3000::MoveDose(long steps) {
+
+	// =================================================================================================================================
+	// This is to dispense a planned amount of food in one move (see PlanDose()):
+	// The function will move the slider from home past the pre-position (see MoveCycleAccurate()) by the given steps, but not further
+	// than the standard distance. The slider stays there, so MoveCycleAccurate() can trim the amount from that position. The function
+	// will return 0 while it is busy, 1 for OK and 3 for warning. The warning is only trigger in case a stall is detected.
+	// WARNING, this function should only be called when the motor is homed! FP3000 cannot see e.g. if the motor has been turned off.
+	// =================================================================================================================================
+
+	// Variables
+	long homePosition = 0;
+	long prePosition = (_std_distance * 0.5 * (-1) * _dir_home);	// Pre-position (50% of std_distance)
+	if (steps > DoseStroke()) {
+		steps = DoseStroke();
+	}
+	long setPosition = prePosition + steps * (-1) * _dir_home;
+
+	// Dose always with the normal microsteps
+	if (StepperMotor.getCurrentPositionInSteps() == homePosition) {
+		SetMicrosteps(_mic_steps);
+	}
+
+	// Command move to position
+	if (MoveTo(setPosition)) {
+		doseSteps += steps;
+
+		if (StepperMotor.checkStall()) {
+			// Flag stall reduction request
+			reduceStall = true;
+			Warning = STEPPER_STALL;
+			positionKnown = false;
+			return WARNING;
+		}
+		else {
+			return OK;
+		}
+	}
+
+	return BUSY;
+}
+
 byte FP3000::EmptyScale(){
 	// =================================================================================================================================
 	// This is to empty the scale:
@@ -396,41 +678,44 @@ byte FP3000::EmptyScale(){
 	// warning. The warning is only trigger in case a stall is detected during the movement.
 	// NOTE, this function will leave the motor at the standard distance position / not move it back home. This is intended to allow
 	// food to be dispensed if there is a scale missfunction.
-	// NOTE, last part of this function is BLOCKING.
+	// The whole motion is queued as segments on the stepper (the pauses are dwells of the queue), so this function does not block.
 	// =================================================================================================================================
 
-	// Variables
-	long setPosition = 0;
-	long homePosition = 0;
-	long targetPosition = (_std_distance * (-1) * _dir_home);
-
-	// Get current position
-	long currentPosition = StepperMotor.getCurrentPositionInSteps();
+	// Queue the motion on first call
+	if (!emptyQueued && StepperMotor.motionComplete()) {
 
-	// If the motor is at the home position, move to the standard distance
-	if (currentPosition == homePosition) {
-		setPosition = targetPosition;
-	}
+		// Variables
+		long setPosition = 0;
+		long homePosition = 0;
+		long targetPosition = (_std_distance * (-1) * _dir_home);
 
-	bool moveResult = MoveTo(setPosition);
+		// If the motor is at the home position, move to the standard distance
+		if (StepperMotor.getCurrentPositionInSteps() == homePosition) {
+			setPosition = targetPosition;
+		}
+		StepperMotor.queueMoveInSteps(setPosition, 0, _motion_profile);
 
-	// If the motor is at the standard distance, do the back and forth motion
-	if (moveResult == true) {
-		// Move back and forth - BLOCKING
-		for(int i = 0; i < 3; i++){
-			delay(200);
-			StepperMotor.moveRelativeInSteps(_std_distance * 0.2 * _dir_home);
-			StepperMotor.moveRelativeInSteps(_std_distance * 0.2 * (-1) * _dir_home);
+		// Move back and forth
+		for (int i = 0; i < 3; i++) {
+			StepperMotor.queueRelativeMoveInSteps(_std_distance * 0.2 * _dir_home, 200, _motion_profile);
+			StepperMotor.queueRelativeMoveInSteps(_std_distance * 0.2 * (-1) * _dir_home, 0, _motion_profile);
 		}
 
 		// Move back home (doesn't need to go all the way back)
-		StepperMotor.moveRelativeInSteps(_std_distance * 0.9 * _dir_home);
+		StepperMotor.queueRelativeMoveInSteps(_std_distance * 0.9 * _dir_home, 0, _motion_profile);
+
+		emptyQueued = true;
+	}
+
+	// If the whole motion is done, finish and check for stall (over all segments)
+	if (StepperMotor.processMovement()) {
+		emptyQueued = false;
 
-		// Finish and check for stall
 		if (StepperMotor.checkStall()) {
 			// Flag stall reduction request
 			reduceStall = true;
 			Warning = STEPPER_STALL;
+			positionKnown = false;
 
 			return WARNING;
 		}
@@ -449,6 +734,8 @@ bool FP3000::MoveTo(long position) {
 	// This is to move the motor to a specified position:
 	// The function will return true when the motor is at its requested position and false when movement is still in progress.
 	// This function is fail-safe and will not move the motor if it is already at the target position.
+	// NOTE, with the step timer (STEP_TIMER) this only sets the target; the steps are emitted from the timer interrupt and the
+	// move continues while core 1 does other work (e.g. weighing).
 	// =================================================================================================================================
 
 	// Check if motor is moving
@@ -457,10 +744,10 @@ bool FP3000::MoveTo(long position) {
 	switch (atPosition) {
 	case true:
 		// Setup movement (will not move if already at target position)
-		StepperMotor.setupMoveInSteps(position);
+		StepperMotor.setupMoveInSteps(position, _motion_profile);
 
-		// Check if setup changed the need to move
-		atPosition = StepperMotor.motionComplete();
+		// Start movement, also checks if setup changed the need to move
+		atPosition = StepperMotor.processMovement();
 		break;
 	case false:
 		// Process movement
@@ -471,6 +758,203 @@ bool FP3000::MoveTo(long position) {
 	return atPosition;
 }
 
+// Set Ramp Table
+// Hands a ramp table computed at compile time (see RampTable.h) to the stepper; moves at the table's speed and
+// acceleration then look up their step periods instead of computing them. Call before SetupMotor().
+void FP3000::SetRampTable(const uint32_t *period, long length, float speed, float accel) {
+	StepperMotor.setRampTable(period, length, speed, accel);
+}
+
+// Set S-Curve
+// Feeding moves (MoveTo, MoveCycle, EmptyScale) then use a jerk limited S-curve profile, the acceleration of SetupMotor()
+// is their max. acceleration. Homing, error handling and autotune keep the constant acceleration.
+void FP3000::SetSCurve(float jerk) {
+	StepperMotor.setJerkInStepsPerSecondPerSecondPerSecond(jerk);
+	_motion_profile = SpeedyStepper4Purr::PROFILE_SCURVE;
+}
+
+// Pop Stall Event
+// Takes the oldest stall (DIAG edge) with its time, position and step period. Returns false if there was none.
+bool FP3000::PopStallEvent(SpeedyStepper4Purr::StallEvent &stallEvent) {
+	return StepperMotor.popStallEvent(stallEvent);
+}
+
+// Stall Position
+// Returns the distance (steps) from home of the first stall since the last call and drops the other stalls, -1 if there was none.
+long FP3000::StallPosition() {
+	SpeedyStepper4Purr::StallEvent stallEvent;
+
+	if (!StepperMotor.popStallEvent(stallEvent)) {
+		return -1;
+	}
+	StepperMotor.clearStallEvents();
+	return abs(stallEvent.position_InSteps);
+}
+
+// Set VACTUAL Moves
+// Coarse moves (homing approach, MoveCycle strokes) then run in VACTUAL mode: the driver turns the motor with its internal pulse
+// generator, no step pulses from the Pico. Only possible with an endstop (expander or pin), which confirms the position at home.
+void FP3000::SetVactualMoves(bool use_vactual) {
+	_use_vactual = use_vactual && HasEndstop();
+}
+
+// Set Fast Microsteps
+// MoveCycle strokes then run with these microsteps (e.g. 8 instead of 32), which cuts the step pulses by the same factor. Has to
+// divide the microsteps of SetupMotor(), else the strokes keep the normal microsteps.
+void FP3000::SetFastMicrosteps(uint16_t fast_mic_steps) {
+	_fast_mic_steps = fast_mic_steps;
+}
+
+// Set Homing Speeds
+// Two speed homing with an endstop: fast approach, back off and a slow re-probe for a repeatable home position (see
+// SpeedyStepper4Purr::setHomingSpeeds). Homing with stall detection keeps the single speed.
+void FP3000::SetHomingSpeeds(float approach_speed, float reprobe_speed, long back_off) {
+	StepperMotor.setHomingSpeeds(approach_speed, reprobe_speed, back_off);
+}
+
+// Set Adaptive Speed
+// MoveCycle strokes then adapt their speed to the load: the driver's StallGuard result (SG_RESULT) is read while pumping, with a
+// large margin to the stall threshold the next stroke is faster (up to max_speed), close to it or after a stall it is slower (down
+// to half the speed). 0 = strokes at the normal speed. NOTE, the UART reads take about 1ms, use with STEP_MODE 1 or 2.
+void FP3000::SetAdaptiveSpeed(float max_speed) {
+	_max_stroke_speed = max_speed;
+	strokeSpeed = _stepper_speed;
+}
+
+// Adapt Stroke Speed
+// Sets the speed of the next stroke from the load of the last one (see SetAdaptiveSpeed) and restores the normal speed. Returns
+// true if the strokes got slower because of a stall.
+bool FP3000::AdaptStrokeSpeed(bool stalled) {
+	if (_max_stroke_speed <= 0) {
+		return false;
+	}
+	StepperMotor.setSpeedInStepsPerSecond(_stepper_speed);
+
+	float lastSpeed = strokeSpeed;
+	float margin = (_stall_val > 0) ? (float)strokeMinLoad / (2 * _stall_val) : LOAD_MARGIN_HIGH;	// Stall at SG_RESULT <= 2 * SGTHRS
+	if (stalled || margin < LOAD_MARGIN_LOW) {
+		strokeSpeed *= STROKE_SPEED_DOWN;
+		if (strokeSpeed < _stepper_speed * STROKE_SPEED_MIN) {
+			strokeSpeed = _stepper_speed * STROKE_SPEED_MIN;
+		}
+	}
+	else if (margin > LOAD_MARGIN_HIGH && strokeMinLoad != 0xFFFF) {
+		strokeSpeed *= STROKE_SPEED_UP;
+		if (strokeSpeed > _max_stroke_speed) {
+			strokeSpeed = _max_stroke_speed;
+		}
+	}
+	return stalled && strokeSpeed < lastSpeed;
+}
+
+// Set Microsteps
+// Switches the driver's microstep resolution, only while the motor is at rest. The stepper keeps counting in the microsteps of
+// SetupMotor() (see SpeedyStepper4Purr::setStepSize), so positions and distances don't change.
+void FP3000::SetMicrosteps(uint16_t mic_steps) {
+	if (mic_steps == 0 || _mic_steps == 0 || _mic_steps % mic_steps != 0) {
+		return;
+	}
+	long stepSize = _mic_steps / mic_steps;
+	if (stepSize == StepperMotor.getStepSize() || !StepperMotor.motionComplete()) {
+		return;
+	}
+	StepperDriver.microsteps(mic_steps);
+	StepperMotor.setStepSize(stepSize);
+}
+
+// Step Jitter
+// Returns the largest deviation (us) of a step from its intended time during the last move (capped at 65535us).
+uint16_t FP3000::StepJitter() {
+	unsigned long jitter = StepperMotor.getMaxStepJitterInUS();
+	return (jitter > 65535) ? 65535 : jitter;
+}
+
+// Pop Step Timing
+// Takes the statistics of how late the steps came (see SpeedyStepper4Purr::getStepTiming) and starts new ones.
+void FP3000::PopStepTiming(SpeedyStepper4Purr::StepTiming &stepTiming) {
+	StepperMotor.getStepTiming(stepTiming);
+	StepperMotor.resetStepTiming();
+}
+
+// Homing Time
+// Returns the duration (ms) of the last homing (capped at 65535ms).
+uint16_t FP3000::HomingTime() {
+	return homingDuration;
+}
+
+// Check Trajectory
+// Plans the feeding moves without moving (see SpeedyStepper4Purr::sampleTrajectory): a stroke (up to TRAJECTORY_SAMPLES steps),
+// the small step of MoveCycleAccurate() and a single step. Checks that every step is planned and that the peak speed and the
+// acceleration / deceleration (speed^2 / (2 * ramp steps)) stay within the set speed and acceleration. Returns the largest excess
+// in percent (0 = within limits, max. 254) or 255 if a move misses steps; nsPerStep receives the planning time per step (ns).
+byte FP3000::CheckTrajectory(uint16_t &nsPerStep) {
+	static uint32_t stepPeriods[TRAJECTORY_SAMPLES];
+	long distances[] = {min(_std_distance, (long)TRAJECTORY_SAMPLES), (long)(_std_distance * 0.01), 1};
+	float excess = 0;
+	unsigned long planTime = 0;
+	long plannedSteps = 0;
+
+	for (long distance : distances) {
+		if (distance < 1) {
+			continue;
+		}
+
+		// Plan
+		unsigned long startTime = micros();
+		long samples = StepperMotor.sampleTrajectory(distance * (-_dir_home), _motion_profile, stepPeriods, TRAJECTORY_SAMPLES);
+		planTime += micros() - startTime;
+		plannedSteps += samples;
+		if (samples != distance) {
+			nsPerStep = 0;
+			return 255;
+		}
+
+		// Peak speed (first and last step at the shortest period)
+		long firstPeak = 0;
+		long lastPeak = 0;
+		for (long i = 1; i < samples; i++) {
+			if (stepPeriods[i] < stepPeriods[firstPeak]) {
+				firstPeak = i;
+				lastPeak = i;
+			}
+			else if (stepPeriods[i] == stepPeriods[firstPeak]) {
+				lastPeak = i;
+			}
+		}
+		float peakSpeed = 65536.0 * 1000000.0 / stepPeriods[firstPeak];
+		float accel = peakSpeed * peakSpeed / (2.0 * (firstPeak + 1));
+		float decel = peakSpeed * peakSpeed / (2.0 * (samples - lastPeak));
+
+		excess = max(excess, peakSpeed / _stepper_speed - 1);
+		excess = max(excess, accel / _stepper_accel - 1);
+		excess = max(excess, decel / _stepper_accel - 1);
+	}
+
+	unsigned long ns = (plannedSteps > 0) ? planTime * 1000 / plannedSteps : 0;
+	nsPerStep = (ns > 65535) ? 65535 : ns;
+	return (excess * 100 > 254) ? 254 : (byte)(excess * 100);
+}
+
+// Recovery Progress
+// Progress of the error handling after a failed homing: phase (high byte, see SpeedyStepper4Purr::ErrorHandlingPhase) and how
+// far the slider is vibrated free (low byte, in 10% steps). 0 if there is no error handling. Returns true if it changed since
+// the last call.
+bool FP3000::RecoveryProgress(uint16_t &progress) {
+	progress = 0;
+	if (managingError) {
+		byte phase = StepperMotor.getErrorHandlingPhase();
+		if (phase == SpeedyStepper4Purr::NOT_HANDLING) {
+			phase = SpeedyStepper4Purr::HOMING_WITH_STALL;	// Endstop stuck high, homing with stall detection
+		}
+		progress = (phase << 8) | (StepperMotor.getErrorHandlingProgress() / 10 * 10);
+	}
+	if (progress == lastRecoveryProgress) {
+		return false;
+	}
+	lastRecoveryProgress = progress;
+	return true;
+}
+
 // Home Motor
 byte FP3000::HomeMotor() {
 
@@ -486,6 +970,8 @@ byte FP3000::HomeMotor() {
 	// Homing
 	switch (homingState) {
 	case START:
+		homingStart = millis();
+		positionKnown = false;
 		// Set a differnt (more sensitive) stall value for homing if wanted
 		StepperDriver.SGTHRS(_home_stall_val);
 		if (_use_expander) {
@@ -493,7 +979,19 @@ byte FP3000::HomeMotor() {
 			expander_endstop_signal = mcp.getPin(_MotorNumber, A); // CHECK DELETE
 		}
 		StepperMotor.checkStall();	// Reset stall measurement
-		homingState = HOMING;
+		SetMicrosteps(_mic_steps);	// Normal microsteps (e.g. after an interrupted MoveCycle)
+		StepperMotor.setSpeedInStepsPerSecond(_stepper_speed);	// Normal speed (e.g. after an adaptive stroke)
+		// Fast approach in VACTUAL mode first (if set and not at the endstop already)
+		homingState = (_use_vactual && !EndstopTriggered()) ? APPROACH : HOMING;
+		break;
+	case APPROACH:
+		// Drive toward the endstop without step pulses, the precise homing with STEP/DIR follows either way
+		if (VactualMove(StepperMotor.getCurrentPositionInSteps() + _max_range * _dir_home, true) != BUSY) {
+			if (_use_expander) {
+				expander_endstop_signal = EndstopTriggered();
+			}
+			homingState = HOMING;
+		}
 		break;
 	case HOMING:
 		// Use external endstop (MCP23017) or use digital pin
@@ -529,11 +1027,31 @@ byte FP3000::HomeMotor() {
 
 		// Reset stall value to normal and homing result
 		StepperDriver.SGTHRS(_stall_val);
+		StepperMotor.clearStallEvents();		// Stalls while homing are no failures
+		{
+			unsigned long duration = millis() - homingStart;
+			homingDuration = (duration > 65535) ? 65535 : duration;
+		}
+		// Position known only if homed at the endstop (Prime() checks it there), stall detection can't be checked quickly
+		positionKnown = (homing_result == OK) && HasEndstop();
 
 		// Check if there was an issue during homing
 		if (homing_result != OK) {
-			// Check Error
-			homing_result = ManageError(homing_result);
+			// Check Error (see RECOVERING)
+			homingState = RECOVERING;
+			break;
+		}
+
+		homingState = START;	// Reset state for next time
+		return homing_result;	// Homing finished, return result.
+	case RECOVERING:
+		// Try to resolve the homing error, ManageError() does one step per call (core 1 stays responsive)
+		{
+			byte errorResult = ManageError(homing_result);
+			if (errorResult == BUSY) {
+				break;
+			}
+			homing_result = errorResult;
 		}
 
 		homingState = START;	// Reset state for next time
@@ -542,6 +1060,129 @@ byte FP3000::HomeMotor() {
 	return BUSY;	// Homing in progress
 }
 
+// Has Endstop
+// True if homing uses an endstop (expander or digital pin), false if it uses the stall detection.
+bool FP3000::HasEndstop() {
+	return _use_expander || _mcp_INTA == 1;
+}
+
+// Endstop Triggered
+// Reads the endstop right now (expander or digital pin), false if there is no endstop.
+bool FP3000::EndstopTriggered() {
+	if (_use_expander) {
+		return mcp.getPin(_MotorNumber, A);
+	}
+	if (_mcp_INTA == 1) {
+		return StepperMotor.getEndstops(true);
+	}
+	return false;
+}
+
+// VACTUAL Move
+byte FP3000::VactualMove(long position, bool toEndstop) {
+
+	// =================================================================================================================================
+	// This is to move the motor in VACTUAL mode (velocity set via UART, the driver generates the steps itself):
+	// The velocity is ramped with the stepper acceleration and the position is estimated from time and velocity, updated every
+	// VACTUAL_UPDATE_US (VACTUAL is only written when it changes, so core 1 is free while cruising). If toEndstop is true, the motor
+	// drives through the position until the endstop triggers, which sets the position to 0 (home). Returns 0 while busy, 1 when done,
+	// 2 if toEndstop is set and the endstop was not reached within VACTUAL_OVERRUN behind the position.
+	// NOTE, a positive VACTUAL is expected to turn the motor like DIR low (positive steps).
+	// =================================================================================================================================
+
+	unsigned long now = micros();
+
+	// Start
+	if (!vactualRunning) {
+		vactualRunning = true;
+		vactualVelocity = 0;
+		vactualPosition = StepperMotor.getCurrentPositionInSteps();
+		vactualLastUpdate = now;
+	}
+
+	if (now - vactualLastUpdate < VACTUAL_UPDATE_US) {
+		return BUSY;
+	}
+
+	// Update the estimated position
+	vactualPosition += vactualVelocity * (now - vactualLastUpdate) / 1E6;
+	vactualLastUpdate = now;
+
+	float remaining = position - vactualPosition;
+	float direction = (remaining < 0) ? -1.0 : 1.0;
+	byte result = BUSY;
+
+	if (toEndstop && EndstopTriggered()) {
+		// Home confirmed by the endstop
+		vactualPosition = 0;
+		result = OK;
+	}
+	else if (toEndstop && vactualVelocity * remaining < 0 && abs(remaining) > _std_distance * VACTUAL_OVERRUN) {
+		// Endstop missed
+		result = ERROR;
+	}
+	else if (!toEndstop && abs(remaining) < 1) {
+		// Position reached
+		result = OK;
+	}
+
+	if (result != BUSY) {
+		StepperDriver.VACTUAL(0);
+		vactualValue = 0;
+		vactualRunning = false;
+		StepperMotor.setCurrentPositionInSteps(lroundf(vactualPosition));
+		StepperMotor.stopMovement();	// Target = position
+		return result;
+	}
+
+	// Accelerate / cruise, or decelerate to stop at the position (not when driving to the endstop)
+	float speed = abs(vactualVelocity) + _stepper_accel * VACTUAL_UPDATE_US / 1E6;
+	if (speed > _stepper_speed) {
+		speed = _stepper_speed;
+	}
+	if (!toEndstop && speed * speed > 2 * _stepper_accel * abs(remaining)) {
+		speed = sqrt(2 * _stepper_accel * abs(remaining));
+	}
+	if (toEndstop && vactualVelocity * remaining < 0) {
+		// Passed the position, keep on toward the endstop
+		direction = -direction;
+	}
+	vactualVelocity = speed * direction;
+
+	int32_t value = lroundf(vactualVelocity * VACTUAL_PER_STEP_RATE / StepperMotor.getStepSize());
+	if (value != vactualValue) {
+		StepperDriver.VACTUAL(value);
+		vactualValue = value;
+	}
+	return BUSY;
+}
+
+// VACTUAL Move To
+// Like MoveTo(), but the move runs in VACTUAL mode. Moves home end at the endstop (position confirmed), if it is missed the motor
+// is homed again with STEP/DIR. Returns true when the motor is at the position.
+bool FP3000::VactualMoveTo(long position) {
+
+	// Home again after a missed endstop
+	if (vactualHoming) {
+		if (HomeMotor() == BUSY) {
+			return false;
+		}
+		vactualHoming = false;
+		return true;
+	}
+
+	if (!vactualRunning && StepperMotor.getCurrentPositionInSteps() == position) {
+		return true;
+	}
+
+	byte result = VactualMove(position, position == 0);
+	if (result == ERROR) {
+		vactualHoming = true;
+		return false;
+	}
+	return (result == OK);
+}
+
 // Test Connection to Stepper Driver
 byte FP3000::Test_Connection() {
 	byte cTest;
@@ -574,75 +1215,110 @@ byte FP3000::AutotuneStall(bool quickCheck, bool saveToFile) {
 	// NOTE, if quickCheck is true, the function will run way faster, but in some instances it may be less accurate - quickCheck = true is
 	// the recommended setting for normal operation.
 	// NOTE, if saveToFile is true, the function will save the stall value to a file, which can be read after a power cycle.
+	// The function does not block (one move per call), it returns 0 while busy, 2 for error, else the stall value.
 	// =====================================================================================================================================
 
-	float factor;		// Percental factor for moving distance
-	float stepFactor;	// Factor for increasing factor
-	byte checkStep;		// Step by which stall sensivity is decreased
+	SpeedyStepper4Purr::StallEvent stallEvent;
+	byte moveStatus;
 
-	// If quick check is true, checking is way faster.
-	if (quickCheck) {
-		// QUICK CHECK SETTINGS
-		_stall_val = 100;
-		factor = 0.1;
-		stepFactor = 0.05;
-		checkStep = 5;
-	}
-	else {
-		// SLOW CHECK SETTINGS
-		_stall_val = 200;
-		factor = 0.01;
-		stepFactor = 0.01;
-		checkStep = 1;
-	}
-	bool stallFlag = false;		// Indicates a stall
-	bool checkFlag = false;		// Helper flag to finish checks
+	switch (autotuneState) {
+	case TUNE_SETUP:
+		positionKnown = false;	// Stalls on purpose
 
-	while (factor <= 1) {
-		// Set stall value
+		// If quick check is true, checking is way faster.
+		if (quickCheck) {
+			// QUICK CHECK SETTINGS
+			_stall_val = 100;
+			tuneFactor = 0.1;
+			tuneStepFactor = 0.05;
+			tuneCheckStep = 5;
+		}
+		else {
+			// SLOW CHECK SETTINGS
+			_stall_val = 200;
+			tuneFactor = 0.01;
+			tuneStepFactor = 0.01;
+			tuneCheckStep = 1;
+		}
+		tuneCheckFlag = false;
+		// fall through
+	case TUNE_START:
+		// Set stall value and move away from endstop
 		StepperDriver.SGTHRS(_stall_val);
+		tuneStartPosition = StepperMotor.getCurrentPositionInSteps();
+		StepperMotor.clearStallEvents();
+		motorMove = StepperMotor.startRelativeMoveInSteps(_std_distance * tuneFactor * (-_dir_home));
+		autotuneState = TUNE_AWAY;
+		break;
+	case TUNE_AWAY:
+		moveStatus = StepperMotor.pollMove(motorMove);
+		if (moveStatus == SpeedyStepper4Purr::MOVE_RUNNING) {
+			break;
+		}
 
-		// Move away from endstop
-		stallFlag = StepperMotor.moveRelativeInSteps(_std_distance * factor * (-_dir_home));
-
-		if (stallFlag) {
+		if (moveStatus == SpeedyStepper4Purr::MOVE_STALLED) {
 			//  Reduce stall value but check if stall value is too low
-			if ((_stall_val -= checkStep) <= 10) {
+			if ((_stall_val -= tuneCheckStep) <= 10) {
 				Error = STALL_CALIBRATION;
+				autotuneState = TUNE_SETUP;	// Reset state for next time
 				return ERROR;
 			}
 			// Return to start
-			StepperMotor.moveRelativeInSteps(_std_distance * factor * _dir_home);
-			// Repeat
-			factor = stepFactor;
+			motorMove = StepperMotor.startRelativeMoveInSteps(_std_distance * tuneFactor * _dir_home);
+			// Repeat from the distance where the stall happened (shorter distances did pass with the more sensitive value)
+			tuneFactor = tuneStepFactor;
+			if (StepperMotor.popStallEvent(stallEvent)) {
+				float stallFactor = (float)abs(stallEvent.position_InSteps - tuneStartPosition) / _std_distance;
+				tuneFactor = max(tuneStepFactor, tuneStepFactor * (int)(stallFactor / tuneStepFactor));
+			}
 		}
 		else {
 			// Return to start
-			StepperMotor.moveRelativeInSteps(_std_distance * factor * _dir_home);
+			motorMove = StepperMotor.startRelativeMoveInSteps(_std_distance * tuneFactor * _dir_home);
 			// No stall occured, increase factor
-			factor += stepFactor;
-			if (factor >= 0.9 && checkFlag == false) {
-				factor = stepFactor;
-				checkFlag = true;
+			tuneFactor += tuneStepFactor;
+			if (tuneFactor >= 0.9 && tuneCheckFlag == false) {
+				tuneFactor = tuneStepFactor;
+				tuneCheckFlag = true;
 			}
 		}
-	}
-	_home_stall_val = _stall_val-5;		// Set stall value for homing (reduce by 5 just to make sure)
-	_stall_val -= 10;					// Reduce stall value by a safety margin of 10
-	StepperDriver.SGTHRS(_stall_val);	// Set final stall value
+		autotuneState = TUNE_RETURN;
+		break;
+	case TUNE_RETURN:
+		if (StepperMotor.pollMove(motorMove) == SpeedyStepper4Purr::MOVE_RUNNING) {
+			break;
+		}
 
-	// Save stall value to file
-	if (saveToFile) {
-		if (!SaveStallVal()) {
-			return ERROR;
-		};
-	}
+		// Next distance
+		if (tuneFactor <= 1) {
+			autotuneState = TUNE_START;
+			break;
+		}
 
-	// If this the dumper drive, move it to the top position so it doesn't block food dispensing for the pumps tuning,
-	StepperMotor.moveRelativeInSteps(_std_distance * (-1) * _dir_home);
+		_home_stall_val = _stall_val-5;		// Set stall value for homing (reduce by 5 just to make sure)
+		_stall_val -= 10;					// Reduce stall value by a safety margin of 10
+		StepperDriver.SGTHRS(_stall_val);	// Set final stall value
 
+		// Save stall value to file
+		if (saveToFile) {
+			if (!SaveStallVal()) {
+				autotuneState = TUNE_SETUP;	// Reset state for next time
+				return ERROR;
+			};
+		}
 
-	return _stall_val;
+		// If this the dumper drive, move it to the top position so it doesn't block food dispensing for the pumps tuning,
+		motorMove = StepperMotor.startRelativeMoveInSteps(_std_distance * (-1) * _dir_home);
+		autotuneState = TUNE_TOP;
+		break;
+	case TUNE_TOP:
+		if (StepperMotor.pollMove(motorMove) == SpeedyStepper4Purr::MOVE_RUNNING) {
+			break;
+		}
+		autotuneState = TUNE_SETUP;	// Reset state for next time
+		return _stall_val;
+	}
+	return BUSY;	// Tuning in progress
 }
 
 // Save Stall Value to File
@@ -691,6 +1367,174 @@ bool FP3000::SaveStallVal() {
 	return true;
 }
 
+// Steps Of A Full Stroke (that dispense food)
+long FP3000::DoseStroke() {
+	// No food is dispensed up to the pre-position (50% of std_distance, see MoveCycleAccurate)
+	return _std_distance - (long)(_std_distance * 0.5);
+}
+
+// Plan Dose
+long FP3000::PlanDose(float grams) {
+
+	// =================================================================================================================================
+	// This is to plan the steps for a desired amount of food with the learned grams per step (see LearnDose()):
+	// The steps count from the pre-position, i.e. DoseStroke() steps are one full MoveCycle(). Fewer steps can be dispensed with
+	// MoveDose(). The function will return -1 if nothing has been learned yet and 0 if no food is needed.
+	// =================================================================================================================================
+
+	if (gramsPerStep <= 0) {
+		return -1;
+	}
+	if (grams <= 0) {
+		return 0;
+	}
+	return lround(grams / gramsPerStep);
+}
+
+// Learn Dose
+void FP3000::LearnDose(float grams) {
+
+	// =================================================================================================================================
+	// This is to learn the grams per step of this pump:
+	// Call it with the food measured after a feeding. It is set against the steps dispensed since the scale was tared (MoveCycle(),
+	// MoveDose() and MoveCycleAccurate() count them), so one accurate measurement per feeding is enough. New feedings are weighted by
+	// DOSE_LEARN_RATE, so single outliers (e.g. a clump of food) do not spoil the model. Save it with SaveDoseModel().
+	// =================================================================================================================================
+
+	if (doseSteps > 0 && grams > 0) {
+		float sample = grams / doseSteps;
+		if (gramsPerStep > 0) {
+			gramsPerStep += DOSE_LEARN_RATE * (sample - gramsPerStep);
+		}
+		else {
+			gramsPerStep = sample;
+		}
+	}
+	doseSteps = 0;
+}
+
+// Learn Accuracy
+void FP3000::LearnAccuracy(float target, float grams) {
+
+	// =================================================================================================================================
+	// This is to learn how accurate this pump feeds:
+	// Call it with the target of a feeding (see DoseTarget()) and the food measured after it. The error (grams - target) updates an
+	// exponentially weighted mean (bias) and variance, weighted by ACCURACY_RATE. Unlike the error of the last feeding alone, this does
+	// not swing from feeding to feeding. Save it with SaveDoseModel().
+	// =================================================================================================================================
+
+	float error = grams - target;
+	if (doseFeedings == 0) {
+		doseBias = error;
+		doseVariance = 0;
+	}
+	else {
+		float diff = error - doseBias;
+		doseBias += ACCURACY_RATE * diff;
+		doseVariance = (1 - ACCURACY_RATE) * (doseVariance + ACCURACY_RATE * diff * diff);
+	}
+	if (doseFeedings < 0xFFFF) {
+		doseFeedings++;
+	}
+}
+
+// Dose Target
+float FP3000::DoseTarget(float amount) {
+	// Amount to aim for, so that on average the desired amount is fed
+	return amount - doseBias;
+}
+
+// Dose Offset
+float FP3000::DoseOffset(float offset) {
+
+	// =================================================================================================================================
+	// This is to adapt an offset below the desired amount (e.g. APP_OFFSET) to the accuracy of this pump:
+	// The offset keeps ACCURACY_SIGMAS standard deviations (plus an overshooting bias) from the desired amount, but stays within
+	// ACCURACY_OFFSET_MIN and ACCURACY_OFFSET_MAX of the given offset. Until ACCURACY_MIN_FEEDINGS are learned, the given offset is used.
+	// =================================================================================================================================
+
+	if (doseFeedings < ACCURACY_MIN_FEEDINGS) {
+		return offset;
+	}
+	float adapted = ACCURACY_SIGMAS * sqrt(doseVariance) + max(doseBias, 0.0f);
+	if (adapted < offset * ACCURACY_OFFSET_MIN) {
+		adapted = offset * ACCURACY_OFFSET_MIN;
+	}
+	if (adapted > offset * ACCURACY_OFFSET_MAX) {
+		adapted = offset * ACCURACY_OFFSET_MAX;
+	}
+	return adapted;
+}
+
+// Dose Accuracy
+void FP3000::DoseAccuracy(float &bias, float &deviation, uint16_t &feedings) {
+	bias = doseBias;
+	deviation = sqrt(doseVariance);
+	feedings = doseFeedings;
+}
+
+// Save Dose Model
+bool FP3000::SaveDoseModel() {
+
+	// =================================================================================================================================
+	// This is to save the learned grams per step and accuracy to a file, which is read by SetupScale() after a power cycle. The function
+	// will return true if it was saved successfully and false if there was an error.
+	// =================================================================================================================================
+
+	// Nothing learned yet
+	if (gramsPerStep <= 0 && doseFeedings == 0) {
+		return true;
+	}
+
+	// Check if file system is mounted
+	if (!LittleFS.begin()) {
+		Error = FILE_SYSTEM;
+		return false;
+	}
+
+	// Write grams per step to file
+	char filename[20];
+	sprintf(filename, "/dose_%d.bin", _nvmAddress);
+	File file = LittleFS.open(filename, "w");
+
+	if (file) {
+		file.write((uint8_t*)&gramsPerStep, sizeof(gramsPerStep));
+		file.write((uint8_t*)&doseBias, sizeof(doseBias));
+		file.write((uint8_t*)&doseVariance, sizeof(doseVariance));
+		file.write((uint8_t*)&doseFeedings, sizeof(doseFeedings));
+		file.close();
+	}
+	else {
+		Error = FILE_SYSTEM;
+		return false;
+	}
+
+	LittleFS.end();
+	return true;
+}
+
+// Measure Food After Stroke
+float FP3000::StrokeWeight(byte measurments) {
+
+	// =================================================================================================================================
+	// This is to get the weight after MoveCycle() without waiting for the scale:
+	// MoveCycle() takes the readings of the scale while the slider returns home, so the weight is ready when the cycle is finished.
+	// Only if fewer readings than measurments were taken (e.g. slow scale, fast stroke), the rest is measured now (blocking).
+	// =================================================================================================================================
+
+	float weightSum = strokeWeightSum;
+	uint16_t weightCount = strokeWeightCount;
+	strokeWeightSum = 0;
+	strokeWeightCount = 0;
+
+	if (weightCount < measurments) {
+		byte missing = measurments - weightCount;
+		weightSum += Measure(missing) * missing;
+		weightCount = measurments;
+	}
+	return weightSum / weightCount;
+}
+
 // Measure Food
 float FP3000::Measure(byte measurments) {
 	float Weight = Scale.get_units(measurments);
@@ -880,7 +1724,7 @@ byte FP3000::CalibrateScale(bool serialResult) {
 }
 
 
-void FP3000::EmergencyMove(uint16_t eCurrent, byte eCycles) {
+byte FP3000::EmergencyMove(uint16_t eCurrent, byte eCycles) {
 
 	// =================================================================================================================================
 	// This is to move the motor in case of an emergency:
@@ -891,36 +1735,63 @@ void FP3000::EmergencyMove(uint16_t eCurrent, byte eCycles) {
 	// case of an emergency. This functions will be the last resort to dispense food in case of a failure.
 	// NOTE, EmergencyMove() expects the current to be set. This can be used to increase the current for the emergency move.
 	// NOTE, EmergencyMove() expects the cycles to be set. This defines roughly the amount of food to be dispensed.
-	// NOTE, the default stepper speed will be halfed automatically. NOTE, this function is BLOCKING. 
+	// NOTE, the default stepper speed will be halfed automatically.
+	// The function does not block (one move per call), it returns 0 while busy and 1 when done. Both motors can move at once.
 	// =================================================================================================================================
 
+	// Moves without homing
+	positionKnown = false;
+
 	// Set emergency current and speed
-	StepperDriver.rms_current(eCurrent);	// Sets the current in milliamps.
-	StepperMotor.setSpeedInStepsPerSecond(_stepper_speed / 4);
+	if (emergencyLeg == 0) {
+		StepperDriver.rms_current(eCurrent);	// Sets the current in milliamps.
+		StepperMotor.setSpeedInStepsPerSecond(_stepper_speed / 4);
+	}
+	else if (StepperMotor.pollMove(motorMove) == SpeedyStepper4Purr::MOVE_RUNNING) {
+		return BUSY;
+	}
 
 	// Check if it is a scale or pump motor (if iAmScale is true, it is the dumper motor)
+	long distance;
 	if (!iAmScale) {
-		// First move a bit towards the endstop (could help to unblock)
-		StepperMotor.moveRelativeInSteps(_std_distance * 0.2 * _dir_home);
-		
-		// Move scale motor away from endstop, with 20% extra distance
-		StepperMotor.moveRelativeInSteps(_std_distance * 1.2 * (-1) * _dir_home);
+		switch (emergencyLeg) {
+		case 0:
+			// First move a bit towards the endstop (could help to unblock)
+			distance = _std_distance * 0.2 * _dir_home;
+			break;
+		case 1:
+			// Move scale motor away from endstop, with 20% extra distance
+			distance = _std_distance * 1.2 * (-1) * _dir_home;
+			break;
+		default:
+			emergencyLeg = 0;	// Reset for next time
+			return OK;
+		}
 	}
 	else {
-		// First move a bit away from the endstop (could help to unblock)
-		StepperMotor.moveRelativeInSteps(_std_distance * 0.2 * (-1) * _dir_home);
-
-		// Move to the endstop position, plus 20% extra distance
-		StepperMotor.moveRelativeInSteps(_std_distance * 1.2 * _dir_home);
-
-		// Perform ten feed cycles
-		// Note that the movent uses 20% extra distance
-		// If there is a blockage this will wear out the hardware quickly
-		for (int i = 0; i < eCycles; i++) {
-			StepperMotor.moveRelativeInSteps(_std_distance * 1.2);
-			StepperMotor.moveRelativeInSteps(-_std_distance * 1.2);
+		switch (emergencyLeg) {
+		case 0:
+			// First move a bit away from the endstop (could help to unblock)
+			distance = _std_distance * 0.2 * (-1) * _dir_home;
+			break;
+		case 1:
+			// Move to the endstop position, plus 20% extra distance
+			distance = _std_distance * 1.2 * _dir_home;
+			break;
+		default:
+			// Perform ten feed cycles (two moves each)
+			// Note that the movent uses 20% extra distance
+			// If there is a blockage this will wear out the hardware quickly
+			if (emergencyLeg >= 2 + 2 * eCycles) {
+				emergencyLeg = 0;	// Reset for next time
+				return OK;
+			}
+			distance = (emergencyLeg % 2 == 0) ? _std_distance * 1.2 : -_std_distance * 1.2;
 		}
 	}
+	motorMove = StepperMotor.startRelativeMoveInSteps(distance);
+	emergencyLeg++;
+	return BUSY;
 }
 
 
@@ -938,10 +1809,21 @@ byte FP3000::ManageError(byte error_code) {
 	// The function receives an error code and tries to resolve it. If the error is resolved, a warning (3) is triggered and the
 	// function returns 3. If the error could not be resolved, a major error (2) is triggered and the function returns 2. Errors and
 	// warnings are saved at Errors / Warrnings and can be checked via function "CheckError() / CheckWarning()".
+	// The function does not block, it returns 0 while busy and has to be called with the same error code until it is done. The
+	// progress can be checked via RecoveryProgress().
 	// =================================================================================================================================
 
 	byte result = BUSY;
 
+	// First call
+	if (!managingError) {
+		managingError = true;
+		positionKnown = false;
+
+		// Stalls from here on show where the slider got stuck (see StallPosition)
+		StepperMotor.clearStallEvents();
+	}
+
 	// Check type of Error
 	// ---------------------------------------------------------
 	// In a failure case, moveToHome() returns (at HomeMotor()):
@@ -951,12 +1833,12 @@ byte FP3000::ManageError(byte error_code) {
 	// ---------------------------------------------------------
 	if (error_code == 2) {
 		// Endstop sensor STUCK HIGH, try to home with stall detection.
-		homing_result = BUSY;
-		while (homing_result == BUSY) {
-			homing_result = StepperMotor.moveToHome(_dir_home, _max_range, false);
+		byte stallHoming = StepperMotor.moveToHome(_dir_home, _max_range, false);
+		if (stallHoming == BUSY) {
+			return BUSY;
 		}
 		// Check if homing was successful
-		if (homing_result == OK) {
+		if (stallHoming == OK) {
 			// Successfully homed with stall detection, yet a warning (3) should be triggered.
 			Warning = STEPPER_ENDSTOP;
 			result = WARNING;	// Warning (3) 
@@ -977,9 +1859,12 @@ byte FP3000::ManageError(byte error_code) {
 		// 1 - unknown drivetrain malfunction
 		// 2 - slider is jammed
 		// 3 - endstop malfunction, solved with stall detection
+		// 4 - still busy
 		// So 0 & 3 equal a warning (3), 1 & 2 equal an error (2).
 		// -------------------------------------------------------
 		switch (result) {
+		case 4:
+			return BUSY;
 		case 0:
 			Warning = STEPPER_FREEDRIVE;
 			result = WARNING;
@@ -1002,6 +1887,7 @@ byte FP3000::ManageError(byte error_code) {
 			result = ERROR;
 		}
 	}
+	managingError = false;
 	return result;
 }
 
@@ -14,11 +14,14 @@
 
 #include <Arduino.h>
 #include "SpeedyStepper4Purr.h"
+#include "SpeedyStepper4PurrFixed.h"
 #include <TMCStepper.h>
 #include <MCP23017.h>
 #include <HX711.h>
 #include <LittleFS.h>
 
+#define TRAJECTORY_SAMPLES	1024		// Max. steps of a move checked by CheckTrajectory() (longer moves are shortened)
+
 class FP3000 {
 
 public:
@@ -27,11 +30,23 @@ public:
 	FP3000(byte MotorNumber, long std_distance, long max_range, long dir_home, float stepper_speed, uint8_t stall_val, bool auto_stall_red,
 		HardwareSerial &serialT, float driver_rsense, uint8_t driver_address, MCP23017 &mcpRef, bool use_expander, byte mcp_INTA);
 
-	byte SetupMotor(uint16_t motor_current, uint16_t mic_steps, uint32_t tcool, byte step_pin, byte dir_pin, byte limit_pin, byte diag_pin, float stepper_accel);
+	byte SetupMotor(uint16_t motor_current, uint16_t mic_steps, uint32_t tcool, byte step_pin, byte dir_pin, byte limit_pin, byte diag_pin, float stepper_accel,
+		byte step_mode, bool fixed_ramp);
 	byte SetupScale(uint8_t nvmAddress, uint8_t dataPin, uint8_t clockPin);
-	byte Prime();
+	byte Prime(bool tareScale = true);
+	void InvalidatePosition();
+	void TareScale();
 	byte MoveCycle();
-	byte MoveCycleAccurate();
+	byte MoveCycleAccurate(float missing = -1);
+	byte MoveDose(long steps);
+	long DoseStroke();
+	long PlanDose(float grams);
+	void LearnDose(float grams);
+	void LearnAccuracy(float target, float grams);
+	float DoseTarget(float amount);
+	float DoseOffset(float offset);
+	void DoseAccuracy(float &bias, float &deviation, uint16_t &feedings);
+	bool SaveDoseModel();
 	byte HomeMotor();
 	byte EmptyScale();
 	bool MoveTo(long position);
@@ -40,8 +55,27 @@ public:
 	byte CheckWarning();
 	bool SaveStallVal();
 	float Measure(byte measurments);
+	float StrokeWeight(byte measurments);
 	byte CalibrateScale(bool serialResult);
-	void EmergencyMove(uint16_t eCurrent, byte eCycles);
+	byte EmergencyMove(uint16_t eCurrent, byte eCycles);
+	uint16_t StepJitter();
+	void PopStepTiming(SpeedyStepper4Purr::StepTiming &stepTiming);
+	uint16_t HomingTime();
+	byte CheckTrajectory(uint16_t &nsPerStep);
+	bool RecoveryProgress(uint16_t &progress);
+	bool PopStallEvent(SpeedyStepper4Purr::StallEvent &stallEvent);
+	long StallPosition();
+	void SetRampTable(const uint32_t *period, long length, float speed, float accel);
+	void SetSCurve(float jerk);
+	void SetVactualMoves(bool use_vactual);
+	void SetFastMicrosteps(uint16_t fast_mic_steps);
+	void SetAdaptiveSpeed(float max_speed);
+	void SetHomingSpeeds(float approach_speed, float reprobe_speed, long back_off);
+
+	// Step timer interrupt (STEP_MODE 1) with the step pin known at compile time (see SpeedyStepper4PurrFixed.h), after
+	// SetupMotor(); false if the motor uses another step pin (it then keeps the runtime step interrupt)
+	template <uint8_t StepPin>
+	bool SetFixedStepPin() { return FixedStepInterrupt<StepPin>::use(StepperMotor); }
 
 	// TESTING - for debugging etc.
 	void MotorTest(bool moveUP);
@@ -53,6 +87,13 @@ private:
 	byte ManageError(byte error_code);
 	bool timerDelay(unsigned int delayTime);
 	byte ReduceStall();
+	bool HasEndstop();
+	bool EndstopTriggered();
+	byte VactualMove(long position, bool toEndstop);
+	bool VactualMoveTo(long position);
+	void SetMicrosteps(uint16_t mic_steps);
+	bool AdaptStrokeSpeed(bool stalled);
+	long AccurateIncrement(float missing);
 
 	// private members
 	SpeedyStepper4Purr StepperMotor;
@@ -66,6 +107,12 @@ private:
 	long _max_range;						// Max range for Motor movement
 	long _dir_home;							// Direction to home (1 = CW, -1 = CCW)
 	float _stepper_speed;					// Speed of the stepper motor
+	float _stepper_accel;					// Acceleration of the stepper motor
+	bool _use_vactual;						// Coarse moves in VACTUAL mode (driver's internal pulse generator)
+	uint16_t _mic_steps;					// Microsteps set in SetupMotor(), positions always count these
+	uint16_t _fast_mic_steps;				// Microsteps for the MoveCycle strokes
+	float _max_stroke_speed;				// Max. speed of adaptive MoveCycle strokes (0 = off)
+	byte _motion_profile;					// Motion profile of feeding moves (trapezoid or S-curve)
 	uint8_t _stall_val;						// Stall value for normal operation
 	uint8_t _home_stall_val;				// Stall value for homing
 	bool _auto_stall_red;					// Automatically reduce stall value
@@ -81,7 +128,42 @@ private:
 	byte calState;
 	bool expander_endstop_signal;
 	unsigned long startTime;
+	unsigned long homingStart;				// Start of the last homing (ms)
+	uint16_t homingDuration;				// Duration of the last homing (ms)
 	bool reduceStall;
+	bool emptyQueued;
+	float strokeSpeed;						// Speed of the next MoveCycle stroke (adaptive speed)
+	bool strokeAway;						// MoveCycle stroke away from home in progress
+	uint16_t strokeMinLoad;					// Lowest SG_RESULT of the stroke
+	unsigned long lastLoadSample;			// Time of the last SG_RESULT reading (ms)
+	float strokeWeightSum;					// Scale readings while the slider returns (see StrokeWeight)
+	uint16_t strokeWeightCount;				// Number of these readings
+	float gramsPerStep;						// Learned food per step beyond the pre-position (0 = not learned yet)
+	long doseSteps;							// Steps dispensed since the scale was tared (see LearnDose)
+	long accurateIncrement;					// Dispensing steps of the MoveCycleAccurate() move in progress
+	long accurateTarget;					// Target of that move
+	bool accurateMoving;					// That move is planned and not reported yet (see MoveCycleAccurate)
+	float accurateStartMissing;				// Missing grams before the first small step (-1 = not yet, see AccurateIncrement)
+	long accurateSteps;						// Small steps dispensed since then
+	float doseBias;							// Mean error of the feedings (g, see LearnAccuracy)
+	float doseVariance;						// Variance of the error (g^2)
+	uint16_t doseFeedings;					// Feedings learned
+	SpeedyStepper4Purr::MoveHandle motorMove;	// Move of AutotuneStall() / EmergencyMove()
+	float tuneFactor;						// Percental factor for moving distance (AutotuneStall)
+	float tuneStepFactor;					// Factor for increasing tuneFactor
+	byte tuneCheckStep;						// Step by which stall sensivity is decreased
+	bool tuneCheckFlag;						// Helper flag to finish checks
+	long tuneStartPosition;					// Position before moving away
+	uint16_t emergencyLeg;					// Next move of EmergencyMove() (0 = not started)
+	bool managingError;						// ManageError() in progress (does one step per call)
+	uint16_t lastRecoveryProgress;			// Last progress returned by RecoveryProgress()
+	bool positionKnown;						// Homed with an endstop and no stall, error or power off since (see Prime)
+	bool vactualRunning;					// VACTUAL move in progress
+	bool vactualHoming;						// Homing after a VACTUAL return stroke missed the endstop
+	float vactualVelocity;					// Commanded velocity (steps/s, signed)
+	float vactualPosition;					// Estimated position (steps)
+	unsigned long vactualLastUpdate;		// Time of the last estimate (us)
+	int32_t vactualValue;					// Last value written to VACTUAL
 
 	// Syntax for function returns
 	enum ReturnCode : byte {
@@ -94,10 +176,21 @@ private:
 	// Homing States
 	enum HomingState {
 		START,
+		APPROACH,
 		HOMING,
-		DONE
+		DONE,
+		RECOVERING
 	}; HomingState homingState;
 
+	// Autotune States
+	enum AutotuneState {
+		TUNE_SETUP,
+		TUNE_START,
+		TUNE_AWAY,
+		TUNE_RETURN,
+		TUNE_TOP
+	}; AutotuneState autotuneState;
+
 	// Error and Warning Codes
 	enum ErrorCode : byte {
 		NO_ERROR,
@@ -0,0 +1,41 @@
+/*
+ * Name:	FastGPIO
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Direct GPIO output through the RP2040 SIO set / clear registers (single store, no Arduino pin layer).
+ * Pins are given as bit masks, so several pins (e.g. the step pins of all motors) switch with one write.
+ * NOTE: the pins need to be set up as outputs first (pinMode), this only writes their levels.
+ * NOTE: open, the max. step rate with digitalWrite and with this path has not been measured yet (needs the board and a
+ * scope or logic analyser on the step pin, the host tests stub both out), so there is no number for the gain and this
+ * path is not known to be faster on the board.
+ * Usage: using StepPins = SioPins<PinMask<STEP_0, STEP_1>::value>; StepPins::high(); StepPins::low();
+*/
+
+#ifndef _FASTGPIO_h
+#define _FASTGPIO_h
+
+#include <stdint.h>
+#include <hardware/structs/sio.h>
+
+// Bit mask of the given GPIO pins
+template <uint8_t... Pins>
+struct PinMask {
+	static constexpr uint32_t value = (0u | ... | (1u << Pins));
+};
+
+// Pins known at compile time
+template <uint32_t Mask>
+struct SioPins {
+	static constexpr uint32_t mask = Mask;
+	static inline void high() { sio_hw->gpio_set = Mask; }
+	static inline void low() { sio_hw->gpio_clr = Mask; }
+	static inline void write(bool level) { if (level) high(); else low(); }
+};
+
+// Pins known at runtime
+inline void SioHigh(uint32_t mask) { sio_hw->gpio_set = mask; }
+inline void SioLow(uint32_t mask) { sio_hw->gpio_clr = mask; }
+
+#endif
@@ -0,0 +1,59 @@
+/*
+ * Name:	RampTable
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Acceleration ramp of SpeedyStepper4Purr, computed at compile time.
+ * Speed and acceleration are fixed in the configuration, so the step periods of the ramp are always the same.
+ * The table holds the period of each step while accelerating from standstill to the desired speed (in US as Q16),
+ * computed with the same recurrence as SpeedyStepper4Purr. Decelerating uses the same table backwards.
+ * Usage: constexpr RampTable<SPEED, ACCEL> rampTable; then hand rampTable.period / rampTable.length to the stepper.
+*/
+
+#ifndef _RAMPTABLE_h
+#define _RAMPTABLE_h
+
+#include <stdint.h>
+
+// Square root for constant expressions (Newton's method)
+constexpr double RampSqrt(double x) {
+	double root = (x > 1.0) ? x : 1.0;
+	for (int i = 0; i < 64; i++) {
+		root = 0.5 * (root + x / root);
+	}
+	return root;
+}
+
+template <long Speed, long Accel>
+struct RampTable {
+
+	static_assert(Speed > 0, "RampTable: speed must be positive");
+	static_assert(Accel >= 117, "RampTable: first step period does not fit Q16 (acceleration < 117 steps/s^2)");
+
+	static constexpr float speed = Speed;		// steps/s
+	static constexpr float accel = Accel;		// steps/s^2
+
+	// Steps to accelerate to the desired speed, Steps = Velocity^2 / (2 * Accelleration)
+	static constexpr long length = (long) ((double) Speed * Speed / (2.0 * Accel) + 0.5);
+	static_assert(length > 0, "RampTable: ramp is shorter than one step");
+
+	uint32_t period[length];
+
+	constexpr RampTable() : period() {
+		// StepPeriodInUS = LastStepPeriodInUS * (1 - AccelerationInStepsPerUSPerUS * LastStepPeriodInUS^2)
+		double stepPeriod = 1000000.0 / RampSqrt(2.0 * Accel);
+		const double desiredStepPeriod = 1000000.0 / Speed;
+		const double acceleration = Accel / 1E12;
+
+		for (long i = 0; i < length; i++) {
+			period[i] = (uint32_t) (stepPeriod * 65536.0 + 0.5);
+			stepPeriod = stepPeriod * (1.0 - acceleration * stepPeriod * stepPeriod);
+			if (stepPeriod < desiredStepPeriod) {
+				stepPeriod = desiredStepPeriod;
+			}
+		}
+	}
+};
+
+#endif
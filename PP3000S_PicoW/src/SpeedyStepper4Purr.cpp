@@ -49,13 +49,48 @@
 // > Adapted Homing function to (almost) non - blocking code, advanced error detection/handling
 //	 and the possibility to change end stop inputs (i.e., from an end stop to driver stall detection).
 //	> NOTE, if the end stop pin (homeEndStopNumber) is set to 99, the end stop signal is expected from an external source / function (see move home).
-//  > NOTE, error handling is BLOCKING code.
-// > WARNING, limited to 4 steppers, as only 4 interrupt pins are available (see switch below).
+// > Up to MAX_STEPPERS (8) steppers, the stall interrupt glue routines are generated from a template (see stallInterrupts_).
+//	 NOTE, STEP_PIO is limited to 4 steppers (one PIO block, three DMA channels per stepper).
+// > Optional step timer (see setStepMode): steps are emitted from a hardware alarm interrupt, so a move
+//	 keeps running while core 1 is busy (e.g. weighing). processMovement() then only starts / checks the move.
+// > Optional PIO step generation (see setStepMode): a PIO state machine emits the step pulses, fed with
+//	 the step periods of the whole ramp by DMA, so no CPU time is spent per step (see StepPulse.pio).
+// > Optional fixed point ramp (see setFixedPointRamp): the RP2040 has no FPU, so the per step ramp
+//	 update can be done in integer math instead (periods in US as Q16).
+// > Optional ramp table (see setRampTable, RampTable.h): for the configured speed and acceleration the
+//	 ramp is computed at compile time, moves then only look up their step periods.
+// > Step and direction pins are written through the SIO set / clear registers (see FastGPIO.h) instead of digitalWrite.
+// > Polled steppers share one step scheduler (see runPolledSteps), so moves of several motors can overlap.
+// > Move segment queue (see queueMoveInSteps): a sequence of moves runs without blocking, consecutive
+//	 segments in the same direction are blended into one move (no stop in between). MoveCycleAccurate() blends
+//	 the pre-position and its first small step; the shakes of EmptyScale() change direction and the later small
+//	 steps stop to weigh, so they do not blend.
+// > Optional S-curve motion profile per move (see setJerkInStepsPerSecondPerSecondPerSecond): the acceleration
+//	 ramps up and down with limited jerk, the ramp is computed once into a table. sampleTrajectory() returns the
+//	 step periods of a planned move without moving, to check a profile on the host.
+// > Stall events (see popStallEvent): every DIAG edge is kept with its time, step position and step period
+//	 in a lock-free ring buffer per stepper, checkStall() still reports whether there was any stall.
+// > Step size (see setStepSize): the driver's microstep resolution can be lowered between moves (fewer step pulses for
+//	 fast moves), positions, speeds and accelerations stay in steps of the native resolution.
+// > Optional two speed homing (see setHomingSpeeds): fast approach, back-off and slow re-probe of the endstop.
+// > Step timing statistics (see getStepTiming): histogram of how late the steps came, missed deadlines and the
+//	 max. lateness, to see how much a busy core delays the steps.
+// > SpeedyStepper4PurrFixed.h: variant with step / direction pin, direction to home and microsteps as template
+//	 parameters, its step timer interrupt pulses the step pin with a constant mask.
+// > Non-blocking moves with a handle (see startMoveInSteps): poll, await or cancel a move, optionally with a
+//	 completion callback. moveRelativeInSteps() awaits such a move.
+// > ErrorHandling() is a state machine (one move per call), so it no longer blocks while freeing a jammed slider.
 
 // =====================================================================================================
 
 
 #include "SpeedyStepper4Purr.h"
+#include <hardware/clocks.h>
+#include "StepPulse.pio.h"
+
+// STEP_PIO timing (see StepPulse.pio): PIO cycles per US and cycles a step takes on top of its period word
+#define PIO_CYCLES_PER_US	10
+#define PIO_STEP_CYCLES		11
 
 // ---------------------------------------------------------------------------------
 //                                  Setup functions 
@@ -68,14 +103,51 @@ SpeedyStepper4Purr::SpeedyStepper4Purr(const byte whichDiag) : whichDiag_ (which
   // initialize constants
   stepPin = 0;
   directionPin = 0;
+  stepPinMask = 0;
+  directionPinMask = 0;
   homeEndStop = 0;
   homeDiagPin = 0;
   currentPosition_InSteps = 0;
+  stepSize_InSteps = 1;
+  positionOffset_InSteps = 0;
+  nativeSpeed_InStepsPerSecond = 200.0;
+  nativeAcceleration_InStepsPerSecondPerSecond = 200.0;
+  nativeJerk_InStepsPerSecondPerSecondPerSecond = 200.0;
+  homingApproachSpeed_InStepsPerSecond = 0.0;
+  homingReprobeSpeed_InStepsPerSecond = 0.0;
+  homingBackOff_InSteps = 0;
   desiredSpeed_InStepsPerSecond = 200.0;
   acceleration_InStepsPerSecondPerSecond = 200.0;
   currentStepPeriod_InUS = 0.0;
+  targetPosition_InSteps = 0;
   homingState = NOT_HOMING;
+  moveHandle_ = 0;
+  moveStatus_ = MOVE_UNKNOWN;
+  moveCallback_ = nullptr;
+  moveContext_ = nullptr;
+  errorHandlingPhase = NOT_HANDLING;
+  errorMove_ = 0;
+  recoverHomeEndStop = 0;
   flagStalled_ = false;
+  stepMode = STEP_POLLED;
+  fixedPointRamp = false;
+  rampTable = nullptr;
+  rampTableLength = 0;
+  ramp = Ramp();
+  jerk_InStepsPerSecondPerSecondPerSecond = 200.0;
+  sCurveTable = nullptr;
+  sCurveTableLength = 0;
+  stepAlarm_ = 0;
+  stepInterrupt_ = StepInterrupt;
+  maxStepJitter_InUS = 0;
+  resetStepTiming();
+  stepPeriodBuffer = nullptr;
+  segmentHead = 0;
+  segmentCount = 0;
+  segmentDwelling = false;
+  stallEventHead_ = 0;
+  stallEventTail_ = 0;
+  droppedStallEvents_ = 0;
 
 }
 
@@ -84,8 +156,8 @@ SpeedyStepper4Purr::SpeedyStepper4Purr(const byte whichDiag) : whichDiag_ (which
 //          directionPinNumber = IO pin number for the direction bit
 // 			homeEndStopNumber = IO pin number for the home limit switch
 // 			homediagPinNumber = IO pin number for the driver stall detection.
-//				>>NOTE: this limits the number of steppers to 4, as only 4
-//						interrupt pins are available (see switch below).
+//				>>NOTE: whichDiag (constructor) selects the interrupt glue routine,
+//						only 0 ... MAX_STEPPERS - 1 get stall detection.
 //
 void SpeedyStepper4Purr::connectToPins(byte stepPinNumber, byte directionPinNumber, byte homeEndStopNumber, byte homeDiagPinNumber)
 {
@@ -94,6 +166,9 @@ void SpeedyStepper4Purr::connectToPins(byte stepPinNumber, byte directionPinNumb
   directionPin = directionPinNumber;
   homeEndStop = homeEndStopNumber;
   homeDiagPin = homeDiagPinNumber;
+  stepPinMask = 1ul << stepPin;
+  directionPinMask = 1ul << directionPin;
+  stepInterrupt_ = StepInterrupt;		// a fixed step interrupt is set again for the new pin
   
   // Configure the IO bits
   pinMode(stepPin, OUTPUT);
@@ -108,50 +183,161 @@ void SpeedyStepper4Purr::connectToPins(byte stepPinNumber, byte directionPinNumb
   }
 
 
-  //Assign interrupts for stall detection. Limited to 4 steppers, as only 4 interrupt pins are available (see switch below).
-  switch (whichDiag_) {
-	case 0:
-		attachInterrupt(digitalPinToInterrupt(homeDiagPin), StallInterrupt0, RISING);
-		instance0_ = this;
-		break;
-	case 1:
-		attachInterrupt(digitalPinToInterrupt(homeDiagPin), StallInterrupt1, RISING);
-		instance1_ = this;
-		break;
-	case 2:
-		attachInterrupt(digitalPinToInterrupt(homeDiagPin), StallInterrupt2, RISING);
-		instance2_ = this;
-		break;
-	case 3:
-		attachInterrupt(digitalPinToInterrupt(homeDiagPin), StallInterrupt3, RISING);
-		instance3_ = this;
-		break;
+  //Assign the interrupt for stall detection (glue routine of this stepper from the table).
+  //The instance is registered first, so an early DIAG edge already finds it.
+  if (whichDiag_ < MAX_STEPPERS) {
+	  instances_[whichDiag_] = this;
+	  attachInterrupt(digitalPinToInterrupt(homeDiagPin), stallInterrupts_[whichDiag_], RISING);
   }
 }
 
-//Interrupt glue routines
-void SpeedyStepper4Purr::StallInterrupt0() {
-	instance0_->StallIndication();
+//Interrupt glue routine (the stepper is a constant, no lookup of the interrupt source)
+template <byte Stepper>
+void SpeedyStepper4Purr::StallInterrupt() {
+	instances_[Stepper]->StallIndication();
 }
-void SpeedyStepper4Purr::StallInterrupt1() {
-	instance1_->StallIndication();
+
+//for use by interrupt glue routines (and the polled step scheduler)
+SpeedyStepper4Purr * SpeedyStepper4Purr::instances_[MAX_STEPPERS];
+
+//Glue routines StallInterrupt<0> ... StallInterrupt<MAX_STEPPERS - 1>
+const std::array<void (*)(), SpeedyStepper4Purr::MAX_STEPPERS> SpeedyStepper4Purr::stallInterrupts_ = 
+	makeStallInterrupts(std::make_integer_sequence<byte, MAX_STEPPERS>());
+
+void SpeedyStepper4Purr::StallIndication() {
+	flagStalled_ = true;
+
+	// Keep the event, unless the buffer is full (the oldest events are the interesting ones)
+	byte nextHead = (stallEventHead_ + 1) % STALL_EVENT_BUFFER_SIZE;
+	if (nextHead == stallEventTail_) {
+		droppedStallEvents_++;
+		return;
+	}
+	StallEvent &stallEvent = stallEvents_[stallEventHead_];
+	stallEvent.time_InUS = micros();
+	stallEvent.position_InSteps = toSteps(getLivePosition(stallEvent.stepPeriod_InUS));
+
+	// Publish the event only after it is written
+	__dmb();
+	stallEventHead_ = nextHead;
 }
-void SpeedyStepper4Purr::StallInterrupt2() {
-	instance2_->StallIndication();
+
+// Select how steps are generated
+// Note: this should only be called when the motor is stopped
+//  Enter:  stepMode = STEP_POLLED, steps are emitted by calling processMovement()
+//			  STEP_TIMER, steps are emitted from a hardware alarm interrupt. The alarm
+//			  pool is created on the calling core, so call this from the core that
+//			  drives the motors (core 1).
+//			  STEP_PIO, steps are emitted by a PIO state machine. Call connectToPins()
+//			  first, the step pin is handed over to the PIO.
+//
+void SpeedyStepper4Purr::setStepMode(byte stepMode)
+{
+  this->stepMode = stepMode;
+
+  // One alarm pool is shared by all steppers (one alarm per stepper)
+  if (stepMode == STEP_TIMER && stepAlarmPool_ == nullptr) {
+	  stepAlarmPool_ = alarm_pool_create_with_unused_hardware_alarm(MAX_STEPPERS);
+  }
+
+  // One state machine, three DMA channels and a period buffer per stepper
+  if (stepMode == STEP_PIO && stepPeriodBuffer == nullptr) {
+	  setupStepPio();
+  }
+}
+
+// Select the ramp math
+// Note: this should only be called when the motor is stopped
+//  Enter:  fixedPointRamp = true to compute the ramp in fixed point (Q16) integer math,
+//			  false for the original float math. Both give the same step periods (within
+//			  1 US), fixed point just avoids the software float emulation of the RP2040.
+//
+void SpeedyStepper4Purr::setFixedPointRamp(bool fixedPointRamp)
+{
+  this->fixedPointRamp = fixedPointRamp;
+}
+
+// Set a ramp table
+// moves at the speed and acceleration the table was made for look up their step periods
+// instead of computing the ramp (see RampTable.h), other moves compute it as before
+// Note: this should only be called when the motor is stopped
+//  Enter:  periodTable = step periods (US as Q16) while accelerating from standstill
+//			tableLength = number of periods (steps to reach the speed)
+//			tableSpeed, tableAccel = speed and acceleration the table was made for
+//
+void SpeedyStepper4Purr::setRampTable(const uint32_t *periodTable, long tableLength, float tableSpeed, float tableAccel)
+{
+  rampTable = periodTable;
+  rampTableLength = tableLength;
+  rampTableSpeed = tableSpeed;
+  rampTableAccel = tableAccel;
 }
-void SpeedyStepper4Purr::StallInterrupt3() {
-	instance3_->StallIndication();
+
+//Step timer glue routine
+int64_t SpeedyStepper4Purr::StepInterrupt(alarm_id_t id, void* user_data) {
+	return static_cast<SpeedyStepper4Purr*>(user_data)->StepIndication();
 }
 
+//for use by the step timer glue routine
+alarm_pool_t * SpeedyStepper4Purr::stepAlarmPool_ = nullptr;
 
-//for use by interrupt glue routines
-SpeedyStepper4Purr * SpeedyStepper4Purr::instance0_;
-SpeedyStepper4Purr * SpeedyStepper4Purr::instance1_;
-SpeedyStepper4Purr * SpeedyStepper4Purr::instance2_;
-SpeedyStepper4Purr * SpeedyStepper4Purr::instance3_;
+//PIO (and program offset) shared by all steppers in STEP_PIO mode
+PIO SpeedyStepper4Purr::stepPio_ = nullptr;
+int SpeedyStepper4Purr::stepPioOffset_ = -1;
 
-void SpeedyStepper4Purr::StallIndication() {
-	flagStalled_ = true;
+// Emit one step from the alarm interrupt
+//  Exit:  negative period in US until the next step (the alarm pool counts a negative
+//		   period from the time this alarm was scheduled, so the timing does not drift;
+//		   a positive one would count from the end of the interrupt), 0 if the move is complete
+int64_t __not_in_flash_func(SpeedyStepper4Purr::StepIndication)() {
+	int64_t nextStepPeriod_InUS;
+
+	// execute the step on the rising edge (no delay needed, the code between rising
+	// and falling edge keeps the pulse well above the 100ns the driver needs)
+	SioHigh(stepPinMask);
+	nextStepPeriod_InUS = advanceTimedStep();
+	SioLow(stepPinMask);
+
+	return nextStepPeriod_InUS;
+}
+
+// Advance a step of the step timer (the caller emits the pulse)
+//  Exit:  negative period in US until the next step (see StepIndication), 0 if the move is complete
+int64_t __not_in_flash_func(SpeedyStepper4Purr::advanceTimedStep)() {
+	unsigned long scheduledTime_InUS = ramp_LastStepTime_InUS + ramp.getNextStepPeriodInUS();
+	unsigned long nextStepPeriod_InUS;
+
+	advanceStep(micros());
+
+	// the next step is due a period after this step's scheduled time (not after
+	// the time it actually came), so the step timing counts the lateness of a step
+	// against the same time the alarm pool does
+	ramp_LastStepTime_InUS = scheduledTime_InUS;
+
+	if (currentPosition_InSteps == targetPosition_InSteps) {
+		stepAlarm_ = 0;
+		return 0;
+	}
+	nextStepPeriod_InUS = ramp.getNextStepPeriodInUS();
+	if (nextStepPeriod_InUS < 1)
+		nextStepPeriod_InUS = 1;
+	return -(int64_t) nextStepPeriod_InUS;
+}
+
+// Set the step timer interrupt
+// replaces the glue routine of the step timer, e.g. by one that pulses a step pin known
+// at compile time (see SpeedyStepper4PurrFixed.h). Note: only while the motor is stopped
+// and after connectToPins()
+//  Enter:  stepInterrupt = alarm callback, user_data is this stepper
+//          stepPinMask = step pin(s) the callback pulses
+//  Exit:   false returned (and nothing changed) if the mask is not the connected step pin
+bool SpeedyStepper4Purr::setStepInterrupt(alarm_callback_t stepInterrupt, uint32_t stepPinMask)
+{
+  if (stepPinMask != this->stepPinMask)
+    return(false);
+
+  stepInterrupt_ = stepInterrupt;
+  return(true);
 }
 
 
@@ -166,7 +352,9 @@ void SpeedyStepper4Purr::StallIndication() {
 //
 void SpeedyStepper4Purr::setCurrentPositionInSteps(long currentPositionInSteps)
 {
-  currentPosition_InSteps = currentPositionInSteps;
+  // the part that is no whole step pulse is kept as offset
+  positionOffset_InSteps = currentPositionInSteps % stepSize_InSteps;
+  currentPosition_InSteps = currentPositionInSteps / stepSize_InSteps;
 }
 
 
@@ -176,16 +364,69 @@ void SpeedyStepper4Purr::setCurrentPositionInSteps(long currentPositionInSteps)
 //
 long SpeedyStepper4Purr::getCurrentPositionInSteps()
 {
-  return(currentPosition_InSteps);
+  return(toSteps(currentPosition_InSteps));
+}
+
+
+// Set the step size, the number of steps (native resolution) one step pulse moves,
+// e.g. 4 if the driver was switched from 32 to 8 microsteps. Positions, speeds and
+// accelerations are still set and returned in steps, only the step pulses (and so 
+// the CPU load) are fewer.
+// Note: this can only be called when the motor is stopped, together with the
+// change of the driver's microstep resolution
+//  Enter:  stepSizeInSteps = steps per step pulse (1 = native resolution)
+//
+void SpeedyStepper4Purr::setStepSize(long stepSizeInSteps)
+{
+  long position_InSteps = getCurrentPositionInSteps();
+
+  stepSize_InSteps = (stepSizeInSteps > 0) ? stepSizeInSteps : 1;
+  setCurrentPositionInSteps(position_InSteps);
+  targetPosition_InSteps = currentPosition_InSteps;
+
+  // speeds of the step pulses
+  desiredSpeed_InStepsPerSecond = nativeSpeed_InStepsPerSecond / stepSize_InSteps;
+  acceleration_InStepsPerSecondPerSecond = nativeAcceleration_InStepsPerSecondPerSecond / stepSize_InSteps;
+  jerk_InStepsPerSecondPerSecondPerSecond = nativeJerk_InStepsPerSecondPerSecondPerSecond / stepSize_InSteps;
+}
+
+
+// Get the step size
+//	Exit:  steps (native resolution) per step pulse
+//
+long SpeedyStepper4Purr::getStepSize()
+{
+  return(stepSize_InSteps);
+}
+
+
+// Convert a position in steps to step pulses (rounded to the nearest pulse)
+//
+long SpeedyStepper4Purr::toPulses(long positionInSteps)
+{
+  long distance_InSteps = positionInSteps - positionOffset_InSteps;
+
+  if (distance_InSteps >= 0)
+    return((distance_InSteps + stepSize_InSteps / 2) / stepSize_InSteps);
+  return(-((-distance_InSteps + stepSize_InSteps / 2) / stepSize_InSteps));
+}
+
+
+// Convert a position in step pulses to steps
+//
+long SpeedyStepper4Purr::toSteps(long positionInPulses)
+{
+  return(positionInPulses * stepSize_InSteps + positionOffset_InSteps);
 }
 
 //
 // Check if the motor has completed its move to the target position
+// (including all queued segments)
 // Exit: true returned if the stepper is at the target position
 //
 bool SpeedyStepper4Purr::motionComplete()
 {
-	if (currentPosition_InSteps == targetPosition_InSteps)
+	if (currentPosition_InSteps == targetPosition_InSteps && segmentCount == 0)
 		return(true);
 	else
 		return(false);
@@ -198,7 +439,8 @@ bool SpeedyStepper4Purr::motionComplete()
 //
 void SpeedyStepper4Purr::setSpeedInStepsPerSecond(float speedInStepsPerSecond)
 {
-  desiredSpeed_InStepsPerSecond = speedInStepsPerSecond;
+  nativeSpeed_InStepsPerSecond = speedInStepsPerSecond;
+  desiredSpeed_InStepsPerSecond = speedInStepsPerSecond / stepSize_InSteps;
 }
 
 
@@ -210,13 +452,51 @@ void SpeedyStepper4Purr::setSpeedInStepsPerSecond(float speedInStepsPerSecond)
 void SpeedyStepper4Purr::setAccelerationInStepsPerSecondPerSecond(
                       float accelerationInStepsPerSecondPerSecond)
 {
-    acceleration_InStepsPerSecondPerSecond = accelerationInStepsPerSecondPerSecond;
+    nativeAcceleration_InStepsPerSecondPerSecond = accelerationInStepsPerSecondPerSecond;
+    acceleration_InStepsPerSecondPerSecond = accelerationInStepsPerSecondPerSecond / stepSize_InSteps;
+}
+
+
+// Set the jerk (rate of change of the acceleration) for S-curve moves, the 
+// acceleration set above is the maximum it ramps up to. Note: the first step of 
+// an S-curve move must be shorter than 65ms, so the jerk should be at least 
+// 22000 steps/second/second/second.
+// Note: this can only be called when the motor is stopped
+//  Enter:  jerkInStepsPerSecondPerSecondPerSecond = jerk, units in 
+//          steps/second/second/second
+//
+void SpeedyStepper4Purr::setJerkInStepsPerSecondPerSecondPerSecond(
+                      float jerkInStepsPerSecondPerSecondPerSecond)
+{
+    nativeJerk_InStepsPerSecondPerSecondPerSecond = jerkInStepsPerSecondPerSecondPerSecond;
+    jerk_InStepsPerSecondPerSecondPerSecond = jerkInStepsPerSecondPerSecondPerSecond / stepSize_InSteps;
+}
+
+
+// Set the homing speeds for two speed homing: the endstop is approached fast, then
+// the motor backs off and probes the endstop again at the (slow) re-probe speed, so
+// the home position does not depend on the approach speed.
+// Only used when homing with an endstop (stall detection does not work slowly).
+// Note: this can only be called when the motor is stopped
+//  Enter:  approachSpeedInStepsPerSecond = speed of the approach, units in steps/second
+//            (0 = speed set above)
+//          reprobeSpeedInStepsPerSecond = speed of the re-probe, units in steps/second
+//            (0 = single speed homing)
+//          backOffDistanceInSteps = unsigned distance to back off the endstop
+//
+void SpeedyStepper4Purr::setHomingSpeeds(float approachSpeedInStepsPerSecond, float reprobeSpeedInStepsPerSecond, 
+  long backOffDistanceInSteps)
+{
+  homingApproachSpeed_InStepsPerSecond = approachSpeedInStepsPerSecond;
+  homingReprobeSpeed_InStepsPerSecond = reprobeSpeedInStepsPerSecond;
+  homingBackOff_InSteps = backOffDistanceInSteps;
 }
 
 
 // HOMING:
 // Home the motor by moving until the homing sensor is activated, then set the 
-// position to zero.
+// position to zero. With two speed homing (see setHomingSpeeds) the endstop is
+// probed a second time slowly.
 //  Enter:  directionTowardHome = 1 to move in a positive direction, -1 to move in 
 //             a negative directions.
 //          maxDistanceToMoveInSteps = unsigned maximum distance to move toward 
@@ -241,11 +521,19 @@ byte SpeedyStepper4Purr::moveToHome(long directionTowardHome, long maxDistanceTo
 		endStop = getEndstops(useHomeEndStop);
 	}
 
+	// Two speed homing only with an endstop (stall detection does not work at the slow re-probe speed).
+	bool twoSpeed = (homingReprobeSpeed_InStepsPerSecond > 0) && (homingBackOff_InSteps > 0) && 
+		(homeEndStop == 99 || useHomeEndStop);
+
 	// Perform homing.
 	switch (homingState){
 
 		// Not yet homing, prepare for homing / do homing.
 		case NOT_HOMING:
+			homingSpeed_InStepsPerSecond = nativeSpeed_InStepsPerSecond;	// Restored when homing is done.
+			if (twoSpeed && homingApproachSpeed_InStepsPerSecond > 0) {
+				setSpeedInStepsPerSecond(homingApproachSpeed_InStepsPerSecond);
+			}
 			// If not in the endstop zone do homing right away.
 			if (!endStop) {
 				setupRelativeMoveInSteps(maxDistanceToMoveInSteps * directionTowardHome);
@@ -267,6 +555,7 @@ byte SpeedyStepper4Purr::moveToHome(long directionTowardHome, long maxDistanceTo
 			}
 			// Out of endstop zone, do homing.
 			else if (!endStop) {
+				haltMovement();
 				setupRelativeMoveInSteps(maxDistanceToMoveInSteps * directionTowardHome);
 				homingState = MOVING_TOWARD_ENDSTOP;
 				homingResult = HOMING_IN_PROGRESS; // Still homing.
@@ -276,13 +565,17 @@ byte SpeedyStepper4Purr::moveToHome(long directionTowardHome, long maxDistanceTo
 			}
 			break;
 
-		// Do homing.
+		// Do homing (fast approach with two speed homing).
 		case MOVING_TOWARD_ENDSTOP:
-			if (endStop) {
+			if (endStop && twoSpeed) {
+				haltMovement();					// Stop right away (step timer may still be running).
+				setupRelativeMoveInSteps(homingBackOff_InSteps * directionTowardHome * -1);
+				homingState = BACKING_OFF_ENDSTOP;
+				homingResult = HOMING_IN_PROGRESS; // Still homing.
+			} else if (endStop) {
+				haltMovement();					// Stop right away (step timer may still be running).
 				homingState = NOT_HOMING;
 				homingResult = HOMING_COMPLETE; // Successfully homed.
-				currentPosition_InSteps = 0;	// Set position to zero.
-				targetPosition_InSteps = 0;		// Reset target position.
 			} else if (!processMovement()) { 
 				homingResult = HOMING_IN_PROGRESS; // Still homing.
 			} else {
@@ -290,25 +583,64 @@ byte SpeedyStepper4Purr::moveToHome(long directionTowardHome, long maxDistanceTo
 				homingResult = HOMING_ERROR_STUCK_LOW; // Error, endstop never reached.
 			}
 			break;
+
+		// Two speed homing: back off the endstop, then probe it again slowly.
+		case BACKING_OFF_ENDSTOP:
+			if (!processMovement()) {
+				homingResult = HOMING_IN_PROGRESS; // Still homing.
+			} else if (endStop) {
+				homingState = NOT_HOMING;
+				homingResult = HOMING_ERROR_STUCK_HIGH; // Error, endstop does not release.
+			} else {
+				setSpeedInStepsPerSecond(homingReprobeSpeed_InStepsPerSecond);
+				setupRelativeMoveInSteps(homingBackOff_InSteps * directionTowardHome * 2);
+				homingState = REPROBING_ENDSTOP;
+				homingResult = HOMING_IN_PROGRESS; // Still homing.
+			}
+			break;
+
+		case REPROBING_ENDSTOP:
+			if (endStop) {
+				haltMovement();					// Stop right away (step timer may still be running).
+				homingState = NOT_HOMING;
+				homingResult = HOMING_COMPLETE; // Successfully homed.
+			} else if (!processMovement()) {
+				homingResult = HOMING_IN_PROGRESS; // Still homing.
+			} else {
+				homingState = NOT_HOMING;
+				homingResult = HOMING_ERROR_STUCK_LOW; // Error, endstop lost.
+			}
+			break;
+	}
+
+	// Homing done, back to the normal speed.
+	if (homingResult != HOMING_IN_PROGRESS) {
+		setSpeedInStepsPerSecond(homingSpeed_InStepsPerSecond);
+	}
+
+	// Homed, set position to zero.
+	if (homingResult == HOMING_COMPLETE) {
+		currentPosition_InSteps = 0;
+		positionOffset_InSteps = 0;
+		targetPosition_InSteps = 0;		// Reset target position.
 	}
 	return (homingResult);
 }
 
 // STEPPER ERROR HANDLING:
-// This function is to recover from a stepper error.
+// This function is to recover from a stepper error. It does not block, call it
+// until it no longer returns 4 (see getErrorHandlingPhase for the progress).
 //  Enter:  error code to start relevant error handling.
 //
 //  Exit:	0 - stuck but solved/freed
 //			1 - unknown drivetrain malfunction
 //			2 - slider is jammed
 //			3 - endstop malfunction, solved with stall detection
+//			4 - still busy
 
 byte SpeedyStepper4Purr::ErrorHandling(long directionTowardHome,
 	long maxDistanceToMoveInSteps, long normal_distance) {
 
-	float recoverSpeed = desiredSpeed_InStepsPerSecond;
-	errorState = ERROR_UNKNOWN; // Need to find the error, otherwise it is unknown.
-
 		// ===========================================================================================
 		// If stall is true, either there is an endstop malfunction or the slider is stuck.
 		// (But if stall is not true, than there is an unknown drivetrain error.)
@@ -318,88 +650,184 @@ byte SpeedyStepper4Purr::ErrorHandling(long directionTowardHome,
 		// If this fails again, then the motor is stuck. Otherwise homing was successful (with stall).
 		// -------------------------------------------------------------------------------------------
 
-	if (flagStalled_) {
-		flagStalled_ = false;
-		long travelDistance = maxDistanceToMoveInSteps * directionTowardHome * -0.1;
+	byte moveStatus;
 
-		if (moveRelativeInSteps(travelDistance)) {
+	switch (errorHandlingPhase) {
 
-			//Slider stuck, try to free it up.
-			int i = 1, y = 1;
+		// Not yet handling, check for a stall.
+		case NOT_HANDLING:
+			errorState = ERROR_UNKNOWN; // Need to find the error, otherwise it is unknown.
 
-			desiredSpeed_InStepsPerSecond = recoverSpeed * 0.2;	// Reduce to generate more torque.
+			// If stall is false, neither the endstop works nor the stall detection.
+			// Unknown drivetrain malfunction >>EMGY mode. ERROR_UNKNOWN is returned.
+			if (flagStalled_) {
+				flagStalled_ = false;
+				recoverSpeed_InStepsPerSecond = desiredSpeed_InStepsPerSecond;
+				recoverTravel_InSteps = maxDistanceToMoveInSteps * directionTowardHome * -0.1;
+				setupErrorMove(recoverTravel_InSteps);
+				errorHandlingPhase = CHECKING_STUCK;
+			}
+			break;
+
+		// Does the slider stall again?
+		case CHECKING_STUCK:
+			moveStatus = pollMove(errorMove_);
+			if (moveStatus == MOVE_RUNNING) {
+				break;
+			}
+			if (moveStatus == MOVE_STALLED) {
+				//Slider stuck, try to free it up.
+				recoverWiggle_InSteps = 1;
+				recoverWiggleCount = 1;
+				desiredSpeed_InStepsPerSecond = recoverSpeed_InStepsPerSecond * 0.2;	// Reduce to generate more torque.
+				setupErrorMove(recoverWiggle_InSteps);
+				errorHandlingPhase = FREEING_SLIDER;
+			}
+			else {
+				setupErrorHoming();
+			}
+			break;
 
-			// Vibrate slider to free up.
-			// ---------------------------------------------------
-			while (i <= abs(travelDistance)) {
-				moveRelativeInSteps(i);
-				if (i > 0) {
-					i = -i;
+		// Vibrate slider to free up, one move per call.
+		case FREEING_SLIDER:
+			if (pollMove(errorMove_) == MOVE_RUNNING) {
+				break;
+			}
+			if (recoverWiggle_InSteps > 0) {
+				recoverWiggle_InSteps = -recoverWiggle_InSteps;
+			}
+			else {
+				if (recoverWiggleCount < 200) {
+					recoverWiggle_InSteps = -recoverWiggle_InSteps + 1;
+					recoverWiggleCount++;
 				}
 				else {
-					if (y < 200) {
-						i = -i + 1;
-						y++;
-					}
-					else {
-						i = -i + y;
-					}
-					desiredSpeed_InStepsPerSecond = recoverSpeed * 0.1 * y;
+					recoverWiggle_InSteps = -recoverWiggle_InSteps + recoverWiggleCount;
 				}
+				desiredSpeed_InStepsPerSecond = recoverSpeed_InStepsPerSecond * 0.1 * recoverWiggleCount;
+			}
+
+			if (recoverWiggle_InSteps <= abs(recoverTravel_InSteps)) {
+				setupErrorMove(recoverWiggle_InSteps);
+			}
+			else {
+				desiredSpeed_InStepsPerSecond = recoverSpeed_InStepsPerSecond;	// Reset speed.
+
+				// Check if slider is free now.
+				setupErrorMove(recoverTravel_InSteps);
+				errorHandlingPhase = CHECKING_FREED;
 			}
-			// ---------------------------------------------------
-			setSpeedInStepsPerSecond(recoverSpeed);	// Reset speed.
+			break;
 
-		
-			// Check if slider is free now.
-			if (moveRelativeInSteps(travelDistance)) {
+		// Is the slider free now?
+		case CHECKING_FREED:
+			moveStatus = pollMove(errorMove_);
+			if (moveStatus == MOVE_RUNNING) {
+				break;
+			}
+			if (moveStatus == MOVE_STALLED) {
 				// Slider still stuck >> EMGY mode.
 				errorState = ERROR_JAMMED;
+				errorHandlingPhase = NOT_HANDLING;
 			}
 			else {
 				// Possible endstop malfunction.
 				errorState = ERROR_FREED;
+				setupErrorHoming();
 			}
-		}
-
-		if(errorState != ERROR_JAMMED){
-
-			// Try to home again (yet with stall detection).
-			byte def_homeEndStop = homeEndStop; // Save default endstop.
-			homeEndStop = 110;		// Set endstop to stall detection.
-			byte home_Check = 0;
-			flagStalled_ = false;	// Reset stall flag.
+			break;
 
-			while (home_Check == 0) {
-				home_Check = moveToHome(directionTowardHome, maxDistanceToMoveInSteps, false);
+		// Try to home again (yet with stall detection).
+		case HOMING_WITH_STALL:
+			switch (moveToHome(directionTowardHome, maxDistanceToMoveInSteps, false)) {
+				case HOMING_IN_PROGRESS:
+					break;
+				case HOMING_COMPLETE:
+					// Check whether a stall occurs when moving up (normal distance)
+					setupErrorMove(normal_distance * (-directionTowardHome));
+					errorHandlingPhase = CHECKING_PATH;
+					break;
+				default:
+					// Unknown drivetrain malfunction >>EMGY mode.
+					errorState = ERROR_UNKNOWN;
+					homeEndStop = recoverHomeEndStop;	// Reset to default endstop.
+					errorHandlingPhase = NOT_HANDLING;
 			}
+			break;
 
-			if (home_Check == 1) {
-				// Check whether a stall occurs when moving up (normal distance)
-				if (moveRelativeInSteps(normal_distance * (-directionTowardHome))) {
-					// Path to homing blocked.
-					errorState = ERROR_JAMMED;
-				}
-				else if (errorState != ERROR_FREED) {
+		// Is the path to homing blocked?
+		case CHECKING_PATH:
+			moveStatus = pollMove(errorMove_);
+			if (moveStatus == MOVE_RUNNING) {
+				break;
+			}
+			if (moveStatus == MOVE_STALLED) {
+				// Path to homing blocked.
+				errorState = ERROR_JAMMED;
+				homeEndStop = recoverHomeEndStop;	// Reset to default endstop.
+				errorHandlingPhase = NOT_HANDLING;
+			}
+			else {
+				if (errorState != ERROR_FREED) {
 					// Homing successful.
 					errorState = ERROR_ENDSTOP;
-					moveRelativeInSteps(normal_distance * directionTowardHome);
-				}
-				else {
-					moveRelativeInSteps(normal_distance * directionTowardHome);
 				}
+				setupErrorMove(normal_distance * directionTowardHome);
+				errorHandlingPhase = RETURNING;
 			}
-			else {
-				// Unknown drivetrain malfunction >>EMGY mode.
-				errorState = ERROR_UNKNOWN;
+			break;
+
+		// Back home, done.
+		case RETURNING:
+			if (pollMove(errorMove_) != MOVE_RUNNING) {
+				homeEndStop = recoverHomeEndStop;	// Reset to default endstop.
+				errorHandlingPhase = NOT_HANDLING;
 			}
+			break;
+	}
 
-			homeEndStop = def_homeEndStop;	// Reset to default endstop.
-		}
+	if (errorHandlingPhase != NOT_HANDLING) {
+		return ERROR_IN_PROGRESS;
 	}
-	// If stall is false, neither the endstop works nor the stall detection.
-	// Unknown drivetrain malfunction >>EMGY mode. ERROR_UNKNOWN is returned.
-return errorState;
+	return errorState;
+}
+
+// Get the phase of the error handling
+//  Exit:   ErrorHandlingPhase, NOT_HANDLING (0) if no error handling is running
+//
+byte SpeedyStepper4Purr::getErrorHandlingPhase()
+{
+  return errorHandlingPhase;
+}
+
+// Get the progress of the error handling while freeing the slider
+//  Exit:   amplitude of the vibration relative to its end (0 - 100 %), 0 in the other phases
+//
+byte SpeedyStepper4Purr::getErrorHandlingProgress()
+{
+  if ((errorHandlingPhase != FREEING_SLIDER) || (recoverTravel_InSteps == 0))
+    return 0;
+
+  long progress = abs(recoverWiggle_InSteps) * 100 / abs(recoverTravel_InSteps);
+  return (progress > 100) ? 100 : progress;
+}
+
+// Setup a move of the error handling (see pollMove)
+//  Enter:  distanceToMoveInSteps = signed distance to move relative to the current position in steps
+//
+void SpeedyStepper4Purr::setupErrorMove(long distanceToMoveInSteps)
+{
+  errorMove_ = startRelativeMoveInSteps(distanceToMoveInSteps);
+}
+
+// Setup homing with stall detection for the error handling
+//
+void SpeedyStepper4Purr::setupErrorHoming()
+{
+  recoverHomeEndStop = homeEndStop;	// Save default endstop.
+  homeEndStop = 110;				// Set endstop to stall detection.
+  flagStalled_ = false;				// Reset stall flag.
+  errorHandlingPhase = HOMING_WITH_STALL;
 }
 
 
@@ -432,11 +860,114 @@ bool SpeedyStepper4Purr::getEndstops(bool whichEndstop) {
 //
 bool SpeedyStepper4Purr::moveRelativeInSteps(long distanceToMoveInSteps)
 {
-	checkStall();	// Reset stall flag.
-	setupRelativeMoveInSteps(distanceToMoveInSteps);
-	while(processMovement() != 1);
+	return (awaitMove(startRelativeMoveInSteps(distanceToMoveInSteps)) == MOVE_STALLED);
+}
+
+
+// Start move
+// setup and start a move, units are in steps, this function returns right away. The move
+// is processed by pollMove() (or in the background with the step timer / PIO), so other
+// motors can move at the same time. A move that is still running is cancelled.
+// Note: this can only be called when the motor is stopped
+//  Enter:  absolutePositionToMoveToInSteps = signed absolute position to move to in 
+//            units of steps
+//          onComplete = called once when the move is done, stalled or cancelled (optional)
+//          context = handed to onComplete
+//          motionProfile = PROFILE_TRAPEZOID (default) or PROFILE_SCURVE
+//  Exit:   handle of the move, for pollMove(), awaitMove() and cancelMove()
+//
+SpeedyStepper4Purr::MoveHandle SpeedyStepper4Purr::startMoveInSteps(long absolutePositionToMoveToInSteps, 
+  MoveCallback onComplete, void *context, byte motionProfile)
+{
+  if (moveStatus_ == MOVE_RUNNING)
+    finishMove(MOVE_CANCELLED);
+
+  // new handle, 0 is no move
+  if (++moveHandle_ == 0)
+    moveHandle_ = 1;
+  moveStatus_ = MOVE_RUNNING;
+  moveCallback_ = onComplete;
+  moveContext_ = context;
+
+  checkStall();	// Reset stall flag.
+  setupMoveInSteps(absolutePositionToMoveToInSteps, motionProfile);
+  processMovement();
+  return moveHandle_;
+}
+
+
+// Start relative move
+// same as startMoveInSteps(), relative to the current position
+//  Enter:  distanceToMoveInSteps = signed distance to move relative to the current 
+//            position in steps
+//          onComplete, context, motionProfile = see startMoveInSteps()
+//  Exit:   handle of the move
+//
+SpeedyStepper4Purr::MoveHandle SpeedyStepper4Purr::startRelativeMoveInSteps(long distanceToMoveInSteps, 
+  MoveCallback onComplete, void *context, byte motionProfile)
+{
+  return startMoveInSteps(getCurrentPositionInSteps() + distanceToMoveInSteps, onComplete, context, motionProfile);
+}
+
+
+// Poll move
+// processes the move and checks if it is done, call this as often as possible
+//  Enter:  handle = handle of the move
+//  Exit:   MOVE_RUNNING, MOVE_DONE, MOVE_STALLED, MOVE_CANCELLED or MOVE_UNKNOWN
+//
+byte SpeedyStepper4Purr::pollMove(MoveHandle handle)
+{
+  if (handle == 0 || handle != moveHandle_)
+    return MOVE_UNKNOWN;
+
+  if (moveStatus_ == MOVE_RUNNING && processMovement())
+    finishMove(checkStall() ? MOVE_STALLED : MOVE_DONE);
+
+  return moveStatus_;
+}
+
+
+// Await move - BLOCKING
+// does not return until the move is done
+//  Enter:  handle = handle of the move
+//  Exit:   MOVE_DONE, MOVE_STALLED, MOVE_CANCELLED or MOVE_UNKNOWN
+//
+byte SpeedyStepper4Purr::awaitMove(MoveHandle handle)
+{
+  byte moveStatus;
+  while ((moveStatus = pollMove(handle)) == MOVE_RUNNING);
+  return moveStatus;
+}
+
 
-	return checkStall();
+// Cancel move
+// stops the motor right away (see stopMovement)
+//  Enter:  handle = handle of the move
+//  Exit:   true returned if the move was running
+//
+bool SpeedyStepper4Purr::cancelMove(MoveHandle handle)
+{
+  if (handle == 0 || handle != moveHandle_ || moveStatus_ != MOVE_RUNNING)
+    return false;
+
+  stopMovement();
+  finishMove(MOVE_CANCELLED);
+  return true;
+}
+
+
+// Finish move
+// sets the status of the current move and calls its callback (once)
+//  Enter:  moveStatus = MOVE_DONE, MOVE_STALLED or MOVE_CANCELLED
+//
+void SpeedyStepper4Purr::finishMove(byte moveStatus)
+{
+  moveStatus_ = moveStatus;
+
+  MoveCallback onComplete = moveCallback_;
+  moveCallback_ = nullptr;
+  if (onComplete != nullptr)
+    onComplete(moveContext_, moveHandle_, moveStatus);
 }
 
 
@@ -446,10 +977,11 @@ bool SpeedyStepper4Purr::moveRelativeInSteps(long distanceToMoveInSteps)
 // motor is stopped
 //  Enter:  distanceToMoveInSteps = signed distance to move relative to the current  
 //          position in steps
+//          motionProfile = PROFILE_TRAPEZOID (default) or PROFILE_SCURVE
 //
-void SpeedyStepper4Purr::setupRelativeMoveInSteps(long distanceToMoveInSteps)
+void SpeedyStepper4Purr::setupRelativeMoveInSteps(long distanceToMoveInSteps, byte motionProfile)
 {
-  setupMoveInSteps(currentPosition_InSteps + distanceToMoveInSteps);
+  setupMoveInSteps(getCurrentPositionInSteps() + distanceToMoveInSteps, motionProfile);
 }
 
 
@@ -458,8 +990,30 @@ void SpeedyStepper4Purr::setupRelativeMoveInSteps(long distanceToMoveInSteps)
 // Note: this can only be called when the motor is stopped
 //  Enter:  absolutePositionToMoveToInSteps = signed absolute position to move to in 
 //          units of steps
+//          motionProfile = PROFILE_TRAPEZOID (default) or PROFILE_SCURVE
+//
+void SpeedyStepper4Purr::setupMoveInSteps(long absolutePositionToMoveToInSteps, byte motionProfile)
+{
+  planMove(toPulses(absolutePositionToMoveToInSteps), motionProfile);
+
+  // set the direction pin
+  if (direction_Scaler < 0)
+    SioHigh(directionPinMask);
+  else
+    SioLow(directionPinMask);
+
+  maxStepJitter_InUS = 0;
+  startNewMove = true;
+}
+
+
+// Plan move
+// compute the ramp of a move (everything of setupMoveInSteps() but the IO)
+//  Enter:  absolutePositionToMoveToInSteps = signed absolute position to move to in 
+//          units of step pulses (see setStepSize)
+//          motionProfile = PROFILE_TRAPEZOID or PROFILE_SCURVE
 //
-void SpeedyStepper4Purr::setupMoveInSteps(long absolutePositionToMoveToInSteps)
+void SpeedyStepper4Purr::planMove(long absolutePositionToMoveToInSteps, byte motionProfile)
 {
   long distanceToTravel_InSteps;
   
@@ -467,58 +1021,372 @@ void SpeedyStepper4Purr::setupMoveInSteps(long absolutePositionToMoveToInSteps)
   // save the target location
   targetPosition_InSteps = absolutePositionToMoveToInSteps;
   
-
-  // determine the period in US of the first step
-  ramp_InitialStepPeriod_InUS =  1000000.0 / sqrt(2.0 * 
-                                    acceleration_InStepsPerSecondPerSecond);
-    
-  // determine the period in US between steps when going at the desired velocity
-  desiredStepPeriod_InUS = 1000000.0 / desiredSpeed_InStepsPerSecond;
-
-
-  // determine the number of steps needed to go from the desired velocity down to a 
-  // velocity of 0, Steps = Velocity^2 / (2 * Accelleration)
-  decelerationDistance_InSteps = (long) round((desiredSpeed_InStepsPerSecond * 
-    desiredSpeed_InStepsPerSecond) / (2.0 * acceleration_InStepsPerSecondPerSecond));
-  
   // determine the distance and direction to travel
   distanceToTravel_InSteps = targetPosition_InSteps - currentPosition_InSteps;
   if (distanceToTravel_InSteps < 0) 
   {
     distanceToTravel_InSteps = -distanceToTravel_InSteps;
     direction_Scaler = -1;
-    digitalWrite(directionPin, HIGH);
   }
   else
   {
     direction_Scaler = 1;
-    digitalWrite(directionPin, LOW);
   }
 
+  planRamp(ramp, distanceToTravel_InSteps, motionProfile);
+}
+
+
+// Plan ramp
+// compute the step periods of a move from standstill over a distance, with the 
+// speed, acceleration and tables of this stepper (see Ramp)
+//  Enter:  moveRamp = ramp to set up
+//          distanceToTravel_InSteps = unsigned distance of the move in step pulses
+//          motionProfile = PROFILE_TRAPEZOID or PROFILE_SCURVE
+//
+void SpeedyStepper4Purr::planRamp(Ramp &moveRamp, long distanceToTravel_InSteps, byte motionProfile)
+{
+  // S-curve moves always use their table (computed once for the speed, acceleration 
+  // and jerk), trapezoid moves use the ramp table if it was made for this move (and 
+  // fits the PIO period buffer)
+  if (motionProfile == PROFILE_SCURVE)
+  {
+    buildSCurveTable();
+    moveRamp.table = sCurveTable;
+    moveRamp.tableLength = sCurveTableLength;
+  }
+  else if ((rampTable != nullptr) && 
+    (desiredSpeed_InStepsPerSecond == rampTableSpeed) && 
+    (acceleration_InStepsPerSecondPerSecond == rampTableAccel) && 
+    (stepMode != STEP_PIO || rampTableLength <= PIO_RAMP_STEPS))
+  {
+    moveRamp.table = rampTable;
+    moveRamp.tableLength = rampTableLength;
+  }
+  else
+  {
+    moveRamp.table = nullptr;
+  }
+  moveRamp.useTable = (moveRamp.table != nullptr);
+
+  if (moveRamp.useTable)
+  {
+    // everything is known from the table, no ramp math needed
+    moveRamp.decelerationDistance_InSteps = moveRamp.tableLength;
+  }
+  else
+  {
+    // determine the period in US of the first step
+    moveRamp.initialStepPeriod_InUS =  1000000.0 / sqrt(2.0 * 
+                                      acceleration_InStepsPerSecondPerSecond);
+      
+    // determine the period in US between steps when going at the desired velocity
+    moveRamp.desiredStepPeriod_InUS = 1000000.0 / desiredSpeed_InStepsPerSecond;
+
+
+    // determine the number of steps needed to go from the desired velocity down to a 
+    // velocity of 0, Steps = Velocity^2 / (2 * Accelleration)
+    moveRamp.decelerationDistance_InSteps = (long) round((desiredSpeed_InStepsPerSecond * 
+      desiredSpeed_InStepsPerSecond) / (2.0 * acceleration_InStepsPerSecondPerSecond));
+  }
+  
   // check if travel distance is too short to accelerate up to the desired velocity
-  if (distanceToTravel_InSteps <= (decelerationDistance_InSteps * 2L))
-    decelerationDistance_InSteps = (distanceToTravel_InSteps / 2L);
+  if (distanceToTravel_InSteps <= (moveRamp.decelerationDistance_InSteps * 2L))
+    moveRamp.decelerationDistance_InSteps = (distanceToTravel_InSteps / 2L);
 
-  // start the acceleration ramp at the beginning
-  ramp_NextStepPeriod_InUS = ramp_InitialStepPeriod_InUS;
-  acceleration_InStepsPerUSPerUS = acceleration_InStepsPerSecondPerSecond / 1E12;
-  startNewMove = true;
+  // start the acceleration ramp at the beginning (the table is read as Q16, like the
+  // fixed point ramp)
+  if (moveRamp.useTable)
+  {
+    moveRamp.fixedPoint = true;
+    moveRamp.stepsTaken = 0;
+    moveRamp.nextStepPeriod_Q16 = moveRamp.table[0];
+    moveRamp.desiredStepPeriod_Q16 = moveRamp.table[moveRamp.tableLength - 1];
+  }
+  else
+  {
+    moveRamp.nextStepPeriod_InUS = moveRamp.initialStepPeriod_InUS;
+    moveRamp.acceleration_InStepsPerUSPerUS = acceleration_InStepsPerSecondPerSecond / 1E12;
+
+    // same ramp in fixed point (periods in US as Q16, acceleration in steps/US/US as Q48),
+    // only if the first period fits (acceleration of at least 117 steps/s/s)
+    moveRamp.fixedPoint = fixedPointRamp && (moveRamp.initialStepPeriod_InUS < 65535.0);
+    moveRamp.decelerating = false;
+    moveRamp.nextStepPeriod_Q16 = (uint32_t) (moveRamp.initialStepPeriod_InUS * 65536.0 + 0.5);
+    moveRamp.desiredStepPeriod_Q16 = (moveRamp.desiredStepPeriod_InUS < 65535.0) ? 
+      (uint32_t) (moveRamp.desiredStepPeriod_InUS * 65536.0 + 0.5) : 0xFFFFFFFF;
+    moveRamp.acceleration_Q48 = (uint64_t) (moveRamp.acceleration_InStepsPerUSPerUS * 281474976710656.0 + 0.5);
+  }
+}
+
+
+// Build the S-curve table
+// computes the step periods (US as Q16) while accelerating from standstill to the 
+// desired speed with limited jerk, like a RampTable. Decelerating uses the table
+// backwards. Only done again when speed, acceleration or jerk have changed. If the 
+// ramp is longer than SCURVE_RAMP_STEPS, the speed is limited to the end of the table.
+//
+void SpeedyStepper4Purr::buildSCurveTable()
+{
+  float jerk = jerk_InStepsPerSecondPerSecondPerSecond;
+  float speed = desiredSpeed_InStepsPerSecond;
+  float jerkTime;
+  float accelTime;
+  float peakAccel;
+  float rampTime;
+  float time;
+  float lastTime;
+  float velocity;
+  float stepPeriod_InUS;
+  long step;
+
+  if (sCurveTable != nullptr && sCurveTableSpeed == speed && 
+    sCurveTableAccel == acceleration_InStepsPerSecondPerSecond && sCurveTableJerk == jerk)
+    return;
+
+  if (sCurveTable == nullptr)
+    sCurveTable = new uint32_t[SCURVE_RAMP_STEPS];
+
+  // phases: jerk up (jerkTime), constant acceleration (accelTime), jerk down (jerkTime),
+  // if the speed is reached before the acceleration is, there is no constant part
+  if (speed * jerk < acceleration_InStepsPerSecondPerSecond * acceleration_InStepsPerSecondPerSecond)
+  {
+    jerkTime = sqrt(speed / jerk);
+    accelTime = 0.0;
+  }
+  else
+  {
+    jerkTime = acceleration_InStepsPerSecondPerSecond / jerk;
+    accelTime = speed / acceleration_InStepsPerSecondPerSecond - jerkTime;
+  }
+  peakAccel = jerk * jerkTime;
+  rampTime = 2.0 * jerkTime + accelTime;
+
+  // position (steps) and velocity (steps/s) at a time (s) of the ramp
+  auto rampPosition = [&](float t, float &v) -> float
+  {
+    float v1 = 0.5 * jerk * jerkTime * jerkTime;
+    float s1 = v1 * jerkTime / 3.0;
+    float v2 = v1 + peakAccel * accelTime;
+    float s2 = s1 + v1 * accelTime + 0.5 * peakAccel * accelTime * accelTime;
+    float s3 = s2 + v2 * jerkTime + 0.5 * peakAccel * jerkTime * jerkTime - jerk * jerkTime * jerkTime * jerkTime / 6.0;
+
+    if (t < jerkTime)
+    {
+      v = 0.5 * jerk * t * t;
+      return(v * t / 3.0);
+    }
+    t -= jerkTime;
+    if (t < accelTime)
+    {
+      v = v1 + peakAccel * t;
+      return(s1 + v1 * t + 0.5 * peakAccel * t * t);
+    }
+    t -= accelTime;
+    if (t < jerkTime)
+    {
+      v = v2 + peakAccel * t - 0.5 * jerk * t * t;
+      return(s2 + v2 * t + 0.5 * peakAccel * t * t - jerk * t * t * t / 6.0);
+    }
+    v = speed;
+    return(s3 + speed * (t - jerkTime));
+  };
+
+  // find the time of every step (Newton's method, starting from the last period)
+  lastTime = 0.0;
+  time = cbrt(6.0 / jerk);
+  for (step = 1; step <= SCURVE_RAMP_STEPS; step++)
+  {
+    // the ramp is done, the rest is cruising
+    if (lastTime >= rampTime)
+    {
+      sCurveTable[step - 1] = (uint32_t) (1000000.0 / speed * 65536.0 + 0.5);
+      break;
+    }
+
+    for (int i = 0; i < 4; i++)
+    {
+      time += (step - rampPosition(time, velocity)) / velocity;
+      if (time <= lastTime)
+        time = lastTime + 1E-6;
+    }
+
+    stepPeriod_InUS = (time - lastTime) * 1000000.0;
+    sCurveTable[step - 1] = (stepPeriod_InUS < 65535.0) ? 
+      (uint32_t) (stepPeriod_InUS * 65536.0 + 0.5) : 0xFFFFFFFF;
+
+    // the next step is about one period later
+    lastTime = time;
+    time += stepPeriod_InUS / 1000000.0;
+  }
+
+  sCurveTableLength = (step > SCURVE_RAMP_STEPS) ? SCURVE_RAMP_STEPS : step;
+  sCurveTableSpeed = speed;
+  sCurveTableAccel = acceleration_InStepsPerSecondPerSecond;
+  sCurveTableJerk = jerk;
+}
+
+
+// Sample trajectory
+// plans a move like setupMoveInSteps() into a ramp of its own (no IO, no motion, the
+// ramp of a running move is not touched) and returns the period before each of its
+// steps, e.g. to check a motion profile on the host
+//  Enter:  distanceToMoveInSteps = signed distance to move relative to the current
+//          position in steps
+//          motionProfile = PROFILE_TRAPEZOID or PROFILE_SCURVE
+//          stepPeriods_Q16 = buffer for the step periods (US as Q16)
+//          maxSamples = size of the buffer
+//  Exit:   number of step periods written
+//
+long SpeedyStepper4Purr::sampleTrajectory(long distanceToMoveInSteps, byte motionProfile, 
+  uint32_t *stepPeriods_Q16, long maxSamples)
+{
+  long distanceToTarget_InSteps;
+  long samples = 0;
+  Ramp trajectory = Ramp();
+
+  distanceToTarget_InSteps = abs(toPulses(getCurrentPositionInSteps() + distanceToMoveInSteps) - currentPosition_InSteps);
+  planRamp(trajectory, distanceToTarget_InSteps, motionProfile);
+
+  for (; distanceToTarget_InSteps > 0 && samples < maxSamples; distanceToTarget_InSteps--)
+  {
+    stepPeriods_Q16[samples++] = trajectory.getNextStepPeriodQ16();
+    trajectory.computeNextStepPeriod(distanceToTarget_InSteps);
+  }
+
+  return(samples);
+}
+
+
+// Queue move
+// add a segment to the move queue, units are in steps. The segments run one after the
+// other by calling processMovement() (no blocking), consecutive segments in the same
+// direction (without dwell) are blended into one move, so there is no stop in between.
+// NOTE, only segments that are queued when a move starts are blended into it, a segment
+// queued while moving starts after a stop.
+//  Enter:  absolutePositionToMoveToInSteps = signed absolute position to move to in 
+//          units of steps
+//          dwellBefore_InMS = pause before this segment starts (0 = none)
+//          motionProfile = PROFILE_TRAPEZOID (default) or PROFILE_SCURVE
+//  Exit:   false returned if the queue is full
+//
+bool SpeedyStepper4Purr::queueMoveInSteps(long absolutePositionToMoveToInSteps, unsigned int dwellBefore_InMS, 
+  byte motionProfile)
+{
+  if (segmentCount >= SEGMENT_QUEUE_SIZE)
+    return(false);
+
+  MoveSegment &segment = segmentQueue[(segmentHead + segmentCount) % SEGMENT_QUEUE_SIZE];
+  segment.targetPosition_InSteps = absolutePositionToMoveToInSteps;
+  segment.dwellBefore_InMS = dwellBefore_InMS;
+  segment.motionProfile = motionProfile;
+  segmentCount++;
+  return(true);
+}
+
+// Queue relative move
+// add a segment relative to the end of the last queued segment (or of the current move)
+//  Enter:  distanceToMoveInSteps = signed distance to move in steps
+//          dwellBefore_InMS = pause before this segment starts (0 = none)
+//          motionProfile = PROFILE_TRAPEZOID (default) or PROFILE_SCURVE
+//  Exit:   false returned if the queue is full
+//
+bool SpeedyStepper4Purr::queueRelativeMoveInSteps(long distanceToMoveInSteps, unsigned int dwellBefore_InMS, 
+  byte motionProfile)
+{
+  long lastPosition_InSteps = toSteps(targetPosition_InSteps);
+
+  if (segmentCount > 0)
+    lastPosition_InSteps = segmentQueue[(segmentHead + segmentCount - 1) % SEGMENT_QUEUE_SIZE].targetPosition_InSteps;
+
+  return(queueMoveInSteps(lastPosition_InSteps + distanceToMoveInSteps, dwellBefore_InMS, motionProfile));
+}
+
+// Get queued segments
+//  Exit:  number of segments waiting in the queue (not counting the current move)
+//
+byte SpeedyStepper4Purr::getQueuedSegments()
+{
+  return(segmentCount);
+}
+
+// Start next segment
+// takes the next segment from the queue (after its dwell) and blends the following
+// segments in the same direction (and with the same motion profile) into it
+//  Exit:  true returned if a new move was set up
+//
+bool SpeedyStepper4Purr::startNextSegment()
+{
+  long blendedTarget_InSteps;
+  long direction;
+  byte motionProfile;
+
+  if (segmentCount == 0)
+    return(false);
+
+  // wait for the dwell of this segment
+  if (segmentQueue[segmentHead].dwellBefore_InMS > 0)
+  {
+    if (!segmentDwelling)
+    {
+      segmentDwelling = true;
+      segmentDwellStart_InMS = millis();
+    }
+    if (millis() - segmentDwellStart_InMS < segmentQueue[segmentHead].dwellBefore_InMS)
+      return(false);
+    segmentDwelling = false;
+  }
+
+  // take the segment and blend all following ones that keep the direction
+  blendedTarget_InSteps = segmentQueue[segmentHead].targetPosition_InSteps;
+  motionProfile = segmentQueue[segmentHead].motionProfile;
+  direction = (blendedTarget_InSteps > getCurrentPositionInSteps()) - (blendedTarget_InSteps < getCurrentPositionInSteps());
+  segmentHead = (segmentHead + 1) % SEGMENT_QUEUE_SIZE;
+  segmentCount--;
+
+  while (segmentCount > 0 && direction != 0 && segmentQueue[segmentHead].dwellBefore_InMS == 0 && 
+    segmentQueue[segmentHead].motionProfile == motionProfile && 
+    ((segmentQueue[segmentHead].targetPosition_InSteps - blendedTarget_InSteps) * direction) > 0)
+  {
+    blendedTarget_InSteps = segmentQueue[segmentHead].targetPosition_InSteps;
+    segmentHead = (segmentHead + 1) % SEGMENT_QUEUE_SIZE;
+    segmentCount--;
+  }
+
+  setupMoveInSteps(blendedTarget_InSteps, motionProfile);
+  return(true);
 }
 
 
 // MOVE: Process movement
 // if it is time, move one step
+// (with the step timer, the first call starts the move and following calls only
+// check whether the interrupt has finished it)
 //  Exit:  true returned if movement complete, false returned not a final target 
 //           position yet
 bool SpeedyStepper4Purr::processMovement(void)
 { 
-  unsigned long currentTime_InUS;
-  unsigned long periodSinceLastStep_InUS;
-  long distanceToTarget_InSteps;
+  // check if already at the target position, if so start the next queued segment
+  if (currentPosition_InSteps == targetPosition_InSteps && !startNextSegment())
+    return(motionComplete());
 
-  // check if already at the target position
-  if (currentPosition_InSteps == targetPosition_InSteps)
-    return(true);
+  // steps are emitted by the step timer, just start it
+  if (stepMode == STEP_TIMER)
+  {
+    if (startNewMove)
+      startStepTimer();
+    return(motionComplete());
+  }
+
+  // steps are emitted by the PIO, start it or check whether it is done
+  if (stepMode == STEP_PIO)
+  {
+    if (startNewMove)
+      startStepPio();
+    else
+      updateStepPioPosition();
+    return(motionComplete());
+  }
 
   // check if this is the first call to start this new move
   if (startNewMove)
@@ -526,62 +1394,477 @@ bool SpeedyStepper4Purr::processMovement(void)
     ramp_LastStepTime_InUS = micros();
     startNewMove = false;
   }
-    
-  // determine how much time has elapsed since the last step (Note 1: this method   
-  // works even if the time has wrapped. Note 2: all variables must be unsigned)
-  currentTime_InUS = micros();
-  periodSinceLastStep_InUS = currentTime_InUS - ramp_LastStepTime_InUS;
 
-  // if it is not time for the next step, return
-  if (periodSinceLastStep_InUS < (unsigned long) ramp_NextStepPeriod_InUS)
-    return(false);
+  // step this and all other polled steppers that are due
+  runPolledSteps();
+ 
+  // check if move has reached its final target position, return true if all done
+  return(motionComplete());
+}
+
+// Run polled steps
+// step scheduler for STEP_POLLED: every polled stepper with a running move takes its
+// step if it is due, the step pins of all of them are pulsed with one SIO write. So a
+// move keeps going while processMovement() (or a blocking move) of another stepper is
+// called, e.g. to home two motors at the same time.
+//
+void SpeedyStepper4Purr::runPolledSteps()
+{
+  SpeedyStepper4Purr *dueSteppers[MAX_STEPPERS];
+  byte dueCount = 0;
+  uint32_t dueStepMask = 0;
+  unsigned long currentTime_InUS = micros();
+
+  // find the steppers that are due (Note 1: this method works even if the time has
+  // wrapped. Note 2: all variables must be unsigned)
+  for (byte i = 0; i < MAX_STEPPERS; i++)
+  {
+    SpeedyStepper4Purr *stepper = instances_[i];
+    if (stepper == nullptr || stepper->stepMode != STEP_POLLED || stepper->startNewMove || 
+      stepper->currentPosition_InSteps == stepper->targetPosition_InSteps)
+      continue;
+    if (currentTime_InUS - stepper->ramp_LastStepTime_InUS < stepper->ramp.getNextStepPeriodInUS())
+      continue;
+    dueSteppers[dueCount++] = stepper;
+    dueStepMask |= stepper->stepPinMask;
+  }
+
+  if (dueCount == 0)
+    return;
+
+  // execute the steps on the rising edge
+  SioHigh(dueStepMask);
+
+  for (byte i = 0; i < dueCount; i++)
+    dueSteppers[i]->advanceStep(currentTime_InUS);
+
+  SioLow(dueStepMask);
+}
+
+// Stop movement
+// stops the motor right away (no deceleration) and sets the target to the current
+// position, e.g. when the endstop is hit. Queued segments are dropped. A homing in
+// progress is aborted, the speed it changed is restored.
+//
+void SpeedyStepper4Purr::stopMovement()
+{
+  haltMovement();
+
+  if (homingState != NOT_HOMING)
+  {
+    homingState = NOT_HOMING;
+    setSpeedInStepsPerSecond(homingSpeed_InStepsPerSecond);
+  }
+}
+
+// Halt movement
+// stops the motor right away like stopMovement(), but keeps a homing going (moveToHome
+// stops at the endstop and goes on with the next phase)
+//
+void SpeedyStepper4Purr::haltMovement()
+{
+  // cancel the step timer first, so the position does not change anymore
+  if (stepAlarm_ > 0)
+  {
+    alarm_pool_cancel_alarm(stepAlarmPool_, stepAlarm_);
+    stepAlarm_ = 0;
+  }
+
+  // stop the PIO, this also sets the position to the steps that were taken
+  if (stepMode == STEP_PIO && !startNewMove && currentPosition_InSteps != targetPosition_InSteps)
+    stopStepPio();
+
+  targetPosition_InSteps = currentPosition_InSteps;
+  currentStepPeriod_InUS = 0.0;
+  startNewMove = false;
+
+  // drop the queued segments
+  segmentCount = 0;
+  segmentDwelling = false;
+}
+
+// Get step jitter
+// largest deviation between the intended and the actual period of a step during the
+// last move, as a measure of the step timing quality (polled vs. step timer)
+//  Exit:  jitter in US
+//
+unsigned long SpeedyStepper4Purr::getMaxStepJitterInUS()
+{
+  return(maxStepJitter_InUS);
+}
+
+// Get step timing
+// statistics of how late the steps came since resetStepTiming(), e.g. while loop1() was
+// busy (STEP_POLLED) or the alarm interrupt was delayed (STEP_TIMER). Steps of the PIO
+// are timed by hardware and not counted.
+//  Enter:  stepTiming = receives the statistics
+//
+void SpeedyStepper4Purr::getStepTiming(StepTiming &stepTiming)
+{
+  uint32_t interrupts = save_and_disable_interrupts();
+  stepTiming = stepTiming_;
+  restore_interrupts(interrupts);
+}
+
+// Reset step timing
+//
+void SpeedyStepper4Purr::resetStepTiming()
+{
+  uint32_t interrupts = save_and_disable_interrupts();
+  stepTiming_ = StepTiming();
+  restore_interrupts(interrupts);
+}
+
+// Start the step timer
+// schedule the first step of a new move. The alarm is armed with interrupts disabled:
+// the alarm pool interrupts the core that set up the step mode (the motor core), and a
+// short move could otherwise end (and clear stepAlarm_) before its id is stored here.
+//
+void SpeedyStepper4Purr::startStepTimer()
+{
+  alarm_id_t alarm;
+  uint32_t interrupts = save_and_disable_interrupts();
+
+  ramp_LastStepTime_InUS = micros();
+  alarm = alarm_pool_add_alarm_in_us(stepAlarmPool_, (uint64_t) ramp.getNextStepPeriodInUS(),
+    stepInterrupt_, this, true);
+
+  // if no alarm was free, try again with the next call
+  if (alarm >= 0)
+  {
+    stepAlarm_ = alarm;
+    startNewMove = false;
+  }
+  restore_interrupts(interrupts);
+}
+
+// Advance step
+// update position and ramp for a step whose pulse is emitted by the caller
+//  Enter:  currentTime_InUS = time of this step
+//
+void __not_in_flash_func(SpeedyStepper4Purr::advanceStep)(unsigned long currentTime_InUS)
+{
+  long distanceToTarget_InSteps;
+  long stepJitter_InUS;
+  unsigned long stepPeriod_InUS = ramp.getNextStepPeriodInUS();
+  byte bucket;
+
+  // remember how far this step is off its intended time
+  stepJitter_InUS = (long) (currentTime_InUS - ramp_LastStepTime_InUS) - (long) stepPeriod_InUS;
+
+  // count how late it is (relative to its period)
+  if (stepJitter_InUS <= 0 || (unsigned long) stepJitter_InUS * 100 <= stepPeriod_InUS)
+    bucket = 0;
+  else if ((unsigned long) stepJitter_InUS * 10 <= stepPeriod_InUS)
+    bucket = 1;
+  else if ((unsigned long) stepJitter_InUS * 2 <= stepPeriod_InUS)
+    bucket = 2;
+  else if ((unsigned long) stepJitter_InUS <= stepPeriod_InUS)
+    bucket = 3;
+  else
+    bucket = 4;
+  stepTiming_.steps++;
+  stepTiming_.lateSteps[bucket]++;
+  if (bucket >= 2)
+    stepTiming_.missedDeadlines++;
+  if (stepJitter_InUS > 0 && (unsigned long) stepJitter_InUS > stepTiming_.maxLateness_InUS)
+    stepTiming_.maxLateness_InUS = stepJitter_InUS;
+
+  if (stepJitter_InUS < 0)
+    stepJitter_InUS = -stepJitter_InUS;
+  if ((unsigned long) stepJitter_InUS > maxStepJitter_InUS)
+    maxStepJitter_InUS = stepJitter_InUS;
 
   // determine the distance from the current position to the target
   distanceToTarget_InSteps = targetPosition_InSteps - currentPosition_InSteps;
   if (distanceToTarget_InSteps < 0) 
     distanceToTarget_InSteps = -distanceToTarget_InSteps;
 
+  // update the current position and speed
+  currentPosition_InSteps += direction_Scaler;
+  currentStepPeriod_InUS = ramp.getNextStepPeriodInUS();
+
+  ramp.computeNextStepPeriod(distanceToTarget_InSteps);
+
+  ramp_LastStepTime_InUS = currentTime_InUS;
+
+  // move complete
+  if (currentPosition_InSteps == targetPosition_InSteps)
+    currentStepPeriod_InUS = 0.0;
+}
+
+// Compute next step period
+// advance the ramp by one step (used for the steps themselves and to fill the PIO
+// period buffer)
+//  Enter:  distanceToTarget_InSteps = unsigned distance to the target before this step
+//
+void __not_in_flash_func(SpeedyStepper4Purr::Ramp::computeNextStepPeriod)(long distanceToTarget_InSteps)
+{
+  uint64_t periodSquared;
+  uint64_t rampFactor;
+  uint32_t periodChange;
+  long tableIndex;
+
+  // ramp table: accelerate by the steps taken, decelerate by the steps left
+  if (useTable)
+  {
+    stepsTaken++;
+    tableIndex = min(stepsTaken, distanceToTarget_InSteps - 2);
+    tableIndex = constrain(tableIndex, 0L, tableLength - 1);
+    nextStepPeriod_Q16 = table[tableIndex];
+    return;
+  }
+
+  // fixed point version of the float math below:
+  // period^2 in US^2 (Q8), acceleration * period^2 (Q32), change of the period (Q16)
+  if (fixedPoint)
+  {
+    if (distanceToTarget_InSteps == decelerationDistance_InSteps)
+      decelerating = true;
+
+    periodSquared = ((uint64_t) nextStepPeriod_Q16 * nextStepPeriod_Q16) >> 24;
+    rampFactor = (acceleration_Q48 * periodSquared) >> 24;
+    if (rampFactor > 0xFFFFFFFF)
+      rampFactor = 0xFFFFFFFF;
+    periodChange = (uint32_t) (((uint64_t) nextStepPeriod_Q16 * rampFactor + 0x80000000) >> 32);
+
+    if (decelerating)
+      nextStepPeriod_Q16 = (periodChange > 0xFFFFFFFF - nextStepPeriod_Q16) ? 
+        0xFFFFFFFF : nextStepPeriod_Q16 + periodChange;
+    else
+      nextStepPeriod_Q16 = (periodChange > nextStepPeriod_Q16) ? 
+        0 : nextStepPeriod_Q16 - periodChange;
+
+    if (nextStepPeriod_Q16 < desiredStepPeriod_Q16)
+      nextStepPeriod_Q16 = desiredStepPeriod_Q16;
+    return;
+  }
+
   // test if it is time to start decelerating, if so change from accelerating to 
   // decelerating
   if (distanceToTarget_InSteps == decelerationDistance_InSteps)
     acceleration_InStepsPerUSPerUS = -acceleration_InStepsPerUSPerUS;
-  
-  // execute the step on the rising edge
-  digitalWrite(stepPin, HIGH);
-  
-  // delay set to almost nothing because there is so much code between rising and 
-  // falling edges
-  delayMicroseconds(2);        
-  
-  // update the current position and speed
-  currentPosition_InSteps += direction_Scaler;
-  currentStepPeriod_InUS = ramp_NextStepPeriod_InUS;
-
 
   // compute the period for the next step
   // StepPeriodInUS = LastStepPeriodInUS * 
   //   (1 - AccelerationInStepsPerUSPerUS * LastStepPeriodInUS^2)
-  ramp_NextStepPeriod_InUS = ramp_NextStepPeriod_InUS * 
-    (1.0 - acceleration_InStepsPerUSPerUS * ramp_NextStepPeriod_InUS * 
-    ramp_NextStepPeriod_InUS);
+  nextStepPeriod_InUS = nextStepPeriod_InUS * 
+    (1.0 - acceleration_InStepsPerUSPerUS * nextStepPeriod_InUS * 
+    nextStepPeriod_InUS);
 
-
-  // return the step line high
-  digitalWrite(stepPin, LOW);
- 
   // clip the speed so that it does not accelerate beyond the desired velocity
-  if (ramp_NextStepPeriod_InUS < desiredStepPeriod_InUS)
-    ramp_NextStepPeriod_InUS = desiredStepPeriod_InUS;
+  if (nextStepPeriod_InUS < desiredStepPeriod_InUS)
+    nextStepPeriod_InUS = desiredStepPeriod_InUS;
+}
 
-  ramp_LastStepTime_InUS = currentTime_InUS;
- 
-  // check if move has reached its final target position, return true if all done
-  if (currentPosition_InSteps == targetPosition_InSteps)
+// Get next step period
+//  Exit:  period in US from the last step to the next one
+//
+unsigned long __not_in_flash_func(SpeedyStepper4Purr::Ramp::getNextStepPeriodInUS)() const
+{
+  if (fixedPoint)
+    return(nextStepPeriod_Q16 >> 16);
+  return((unsigned long) nextStepPeriod_InUS);
+}
+
+// Get next step period in fixed point
+//  Exit:  period in US from the last step to the next one, as Q16
+//
+uint32_t SpeedyStepper4Purr::Ramp::getNextStepPeriodQ16() const
+{
+  if (fixedPoint)
+    return(nextStepPeriod_Q16);
+  if (nextStepPeriod_InUS >= 65535.0)
+    return(0xFFFFFFFF);
+  return((uint32_t) (nextStepPeriod_InUS * 65536.0 + 0.5));
+}
+
+// Skip steps of the ramp
+// for cruising steps that are not computed (the period does not change while cruising,
+// only the table position moves on)
+//  Enter:  steps = number of cruising steps taken
+void SpeedyStepper4Purr::Ramp::skipSteps(long steps)
+{
+  stepsTaken += steps;
+}
+
+// Setup PIO step generation
+// loads the step pulse program (once for all steppers), claims a state machine
+// and three DMA channels for the segments of a move: accelerating ramp, cruise
+// (one period repeated) and decelerating ramp. The step pin is handed to the PIO.
+//
+void SpeedyStepper4Purr::setupStepPio()
+{
+  pio_sm_config smConfig;
+
+  // load the program into the first PIO with enough space
+  if (stepPioOffset_ < 0)
   {
-    currentStepPeriod_InUS = 0.0;
-    return(true);
+    stepPio_ = pio_can_add_program(pio0, &step_pulse_program) ? pio0 : pio1;
+    stepPioOffset_ = pio_add_program(stepPio_, &step_pulse_program);
+  }
+  stepPioSm = pio_claim_unused_sm(stepPio_, true);
+
+  // the step pin is driven by side set, one cycle takes 0.1 US
+  pio_gpio_init(stepPio_, stepPin);
+  pio_sm_set_consecutive_pindirs(stepPio_, stepPioSm, stepPin, 1, true);
+  smConfig = step_pulse_program_get_default_config(stepPioOffset_);
+  sm_config_set_sideset_pins(&smConfig, stepPin);
+  sm_config_set_clkdiv(&smConfig, (float) clock_get_hz(clk_sys) / (PIO_CYCLES_PER_US * 1E6));
+  pio_sm_init(stepPio_, stepPioSm, stepPioOffset_, &smConfig);
+  pio_sm_set_enabled(stepPio_, stepPioSm, true);
+
+  for (int i = 0; i < 3; i++)
+    stepDmaChannel[i] = dma_claim_unused_channel(true);
+
+  // accelerating ramp in the first half, decelerating ramp in the second half
+  stepPeriodBuffer = new uint32_t[2 * PIO_RAMP_STEPS];
+}
+
+// Start PIO step generation
+// turns the ramps set up by setupMoveInSteps() into step periods (in PIO cycles) and
+// starts the DMA, which feeds them to the state machine without any CPU work. Only the
+// accelerating and decelerating steps are computed, the cruise is one period the DMA
+// sends again for every cruise step (its period does not change, so the ramp is
+// only continued at its end).
+//
+void SpeedyStepper4Purr::startStepPio()
+{
+  long distanceToTarget_InSteps;
+  long cruiseSteps;
+  uint32_t *decelBuffer = stepPeriodBuffer + PIO_RAMP_STEPS;
+  const volatile void *segmentSource[3] = {stepPeriodBuffer, &stepCruisePeriod, decelBuffer};
+  dma_channel_config dmaConfig;
+  int nextChannel = -1;
+
+  // limit the speed of this move, so that the ramps fit into the period buffer
+  if (ramp.decelerationDistance_InSteps > PIO_RAMP_STEPS)
+  {
+    ramp.decelerationDistance_InSteps = PIO_RAMP_STEPS;
+    ramp.desiredStepPeriod_InUS = 1000000.0 / sqrt(2.0 * 
+      acceleration_InStepsPerSecondPerSecond * PIO_RAMP_STEPS);
+    ramp.desiredStepPeriod_Q16 = (uint32_t) (ramp.desiredStepPeriod_InUS * 65536.0 + 0.5);
+  }
+
+  // accelerating steps, until the speed or the deceleration is reached
+  stepPioCount[0] = stepPioCount[1] = stepPioCount[2] = 0;
+  distanceToTarget_InSteps = abs(targetPosition_InSteps - currentPosition_InSteps);
+  while (distanceToTarget_InSteps >= ramp.decelerationDistance_InSteps && distanceToTarget_InSteps > 0 &&
+    ramp.getNextStepPeriodQ16() > ramp.desiredStepPeriod_Q16 && stepPioCount[0] < PIO_RAMP_STEPS)
+  {
+    stepPeriodBuffer[stepPioCount[0]++] = toPioCycles(ramp.getNextStepPeriodQ16());
+    ramp.computeNextStepPeriod(distanceToTarget_InSteps--);
+  }
+
+  // cruising steps, one period (the ramp only goes on with the last one, where the
+  // deceleration starts)
+  cruiseSteps = distanceToTarget_InSteps - max(ramp.decelerationDistance_InSteps - 1, 0L);
+  if (cruiseSteps > 0)
+  {
+    stepPioCount[1] = cruiseSteps;
+    stepCruisePeriod = toPioCycles(ramp.getNextStepPeriodQ16());
+    distanceToTarget_InSteps -= cruiseSteps - 1;
+    ramp.skipSteps(cruiseSteps - 1);
+    ramp.computeNextStepPeriod(distanceToTarget_InSteps--);
+  }
+
+  // decelerating steps
+  for (; distanceToTarget_InSteps > 0; distanceToTarget_InSteps--)
+  {
+    decelBuffer[stepPioCount[2]++] = toPioCycles(ramp.getNextStepPeriodQ16());
+    ramp.computeNextStepPeriod(distanceToTarget_InSteps);
+  }
+
+  // hold the state machine while the DMA is set up, reset the step counter (Y)
+  pio_sm_set_enabled(stepPio_, stepPioSm, false);
+  pio_sm_exec(stepPio_, stepPioSm, pio_encode_mov(pio_y, pio_null));
+
+  // chain the DMA channels of all segments with steps (backwards, so the next is known)
+  for (int i = 2; i >= 0; i--)
+  {
+    if (stepPioCount[i] == 0)
+      continue;
+    dmaConfig = dma_channel_get_default_config(stepDmaChannel[i]);
+    channel_config_set_transfer_data_size(&dmaConfig, DMA_SIZE_32);
+    channel_config_set_read_increment(&dmaConfig, i != 1);
+    channel_config_set_write_increment(&dmaConfig, false);
+    channel_config_set_dreq(&dmaConfig, pio_get_dreq(stepPio_, stepPioSm, true));
+    channel_config_set_chain_to(&dmaConfig, nextChannel >= 0 ? nextChannel : stepDmaChannel[i]);
+    dma_channel_configure(stepDmaChannel[i], &dmaConfig, &stepPio_->txf[stepPioSm], 
+      segmentSource[i], stepPioCount[i], false);
+    nextChannel = stepDmaChannel[i];
+  }
+  dma_channel_start(nextChannel);
+  pio_sm_set_enabled(stepPio_, stepPioSm, true);
+
+  stepPioStartPosition = currentPosition_InSteps;
+  startNewMove = false;
+}
+
+// Update PIO position
+// the move is complete, once all periods were sent and the state machine waits for more
+// (back at its pull: with the FIFO empty and the DMA done, it only gets there after the
+// last step)
+//
+void SpeedyStepper4Purr::updateStepPioPosition()
+{
+  if (!stepPioDmaBusy() && pio_sm_is_tx_fifo_empty(stepPio_, stepPioSm) && 
+    pio_sm_get_pc(stepPio_, stepPioSm) == (uint) stepPioOffset_ + step_pulse_wrap_target)
+    currentPosition_InSteps = targetPosition_InSteps;
+}
+
+// Step period in PIO cycles
+// the low time the state machine waits for a step period (US as Q16)
+//
+uint32_t SpeedyStepper4Purr::toPioCycles(uint32_t stepPeriod_Q16)
+{
+  long stepCycles = (long) (((uint64_t) stepPeriod_Q16 * PIO_CYCLES_PER_US) >> 16) - PIO_STEP_CYCLES;
+
+  return((stepCycles > 0) ? (uint32_t) stepCycles : 0);
+}
+
+// Stop PIO step generation
+// aborts the DMA, drops the queued periods and sets the position to the steps taken
+//
+void SpeedyStepper4Purr::stopStepPio()
+{
+  dma_channel_config dmaConfig;
+  uint32_t stepsTaken;
+
+  // freeze the state machine, then stop the DMA (unchained first, so an abort cannot
+  // trigger the next segment)
+  pio_sm_set_enabled(stepPio_, stepPioSm, false);
+  for (int i = 0; i < 3; i++)
+  {
+    dmaConfig = dma_get_channel_config(stepDmaChannel[i]);
+    channel_config_set_chain_to(&dmaConfig, stepDmaChannel[i]);
+    dma_channel_set_config(stepDmaChannel[i], &dmaConfig, false);
+  }
+  for (int i = 0; i < 3; i++)
+    dma_channel_abort(stepDmaChannel[i]);
+  pio_sm_clear_fifos(stepPio_, stepPioSm);
+
+  // read the step counter (Y counts down from 0)
+  pio_sm_exec(stepPio_, stepPioSm, pio_encode_mov(pio_isr, pio_y));
+  pio_sm_exec(stepPio_, stepPioSm, pio_encode_push(false, false));
+  stepsTaken = -pio_sm_get(stepPio_, stepPioSm);
+  currentPosition_InSteps = stepPioStartPosition + (long) stepsTaken * direction_Scaler;
+
+  // restart the program with the step pin low
+  pio_sm_exec(stepPio_, stepPioSm, pio_encode_jmp(stepPioOffset_) | pio_encode_sideset(1, 0));
+  pio_sm_set_enabled(stepPio_, stepPioSm, true);
+}
+
+// Check PIO DMA
+//  Exit:  true returned if any DMA channel of this stepper is still sending periods
+//
+bool SpeedyStepper4Purr::stepPioDmaBusy()
+{
+  for (int i = 0; i < 3; i++)
+  {
+    if (dma_channel_is_busy(stepDmaChannel[i]))
+      return(true);
   }
-    
   return(false);
 }
 
@@ -597,5 +1880,76 @@ bool SpeedyStepper4Purr::checkStall() {
 	}
 }
 
+// Pop stall event
+// takes the oldest stall event from the buffer
+//  Enter:  stallEvent = receives the event
+//  Exit:   true returned if there was an event, false if the buffer is empty
+bool SpeedyStepper4Purr::popStallEvent(StallEvent &stallEvent) {
+	if (stallEventTail_ == stallEventHead_)
+		return false;
+
+	__dmb();
+	stallEvent = stallEvents_[stallEventTail_];
+	__dmb();
+	stallEventTail_ = (stallEventTail_ + 1) % STALL_EVENT_BUFFER_SIZE;
+	return true;
+}
+
+// Get stall event count
+//  Exit:  number of stall events in the buffer
+byte SpeedyStepper4Purr::getStallEventCount() {
+	return (stallEventHead_ - stallEventTail_ + STALL_EVENT_BUFFER_SIZE) % STALL_EVENT_BUFFER_SIZE;
+}
+
+// Clear stall events
+// drops all events in the buffer (e.g. before a move whose stalls should be checked)
+void SpeedyStepper4Purr::clearStallEvents() {
+	stallEventTail_ = stallEventHead_;
+}
+
+// Get dropped stall events
+//  Exit:  number of stall events that were lost because the buffer was full
+unsigned long SpeedyStepper4Purr::getDroppedStallEvents() {
+	return droppedStallEvents_;
+}
+
+// Get live position
+// position and step period right now, also while the PIO runs a move (the position is
+// only updated at the end of a PIO move). Safe to call from an interrupt.
+//  Enter:  stepPeriod_InUS = receives the current step period (0 = standing)
+//  Exit:   position in steps (in STEP_PIO within one step)
+long SpeedyStepper4Purr::getLivePosition(float &stepPeriod_InUS) {
+	long periodsPulled = 0;
+	long stepCycles;
+
+	if (stepMode != STEP_PIO || startNewMove || currentPosition_InSteps == targetPosition_InSteps) {
+		stepPeriod_InUS = currentStepPeriod_InUS;
+		return currentPosition_InSteps;
+	}
+
+	// periods the state machine has taken (sent by the DMA, no longer in the FIFO), 
+	// the last one is the step in progress
+	for (int i = 0; i < 3; i++) {
+		if (stepPioCount[i] > 0)
+			periodsPulled += stepPioCount[i] - (long) dma_hw->ch[stepDmaChannel[i]].transfer_count;
+	}
+	periodsPulled -= pio_sm_get_tx_fifo_level(stepPio_, stepPioSm);
+	if (periodsPulled <= 0) {
+		stepPeriod_InUS = 0.0;
+		return stepPioStartPosition;
+	}
+
+	// period of the step in progress, from its segment
+	if (periodsPulled <= stepPioCount[0])
+		stepCycles = stepPeriodBuffer[periodsPulled - 1];
+	else if (periodsPulled <= stepPioCount[0] + stepPioCount[1])
+		stepCycles = stepCruisePeriod;
+	else
+		stepCycles = stepPeriodBuffer[PIO_RAMP_STEPS + periodsPulled - 1 - stepPioCount[0] - stepPioCount[1]];
+	stepPeriod_InUS = (float) (stepCycles + PIO_STEP_CYCLES) / PIO_CYCLES_PER_US;
+
+	return stepPioStartPosition + (periodsPulled - 1) * direction_Scaler;
+}
+
 // -------------------------------------- End --------------------------------------
 
@@ -40,74 +40,312 @@
 
 #include <Arduino.h>
 #include <stdlib.h>
+#include <array>
+#include <utility>
 #include <MCP23017.h>
+#include <pico/time.h>
+#include <hardware/pio.h>
+#include <hardware/dma.h>
+#include <hardware/sync.h>
+#include "FastGPIO.h"
 
 
 
 //  SpeedyStepper4Purr class
 class SpeedyStepper4Purr
 {
+  public:
+
+    // Max. number of steppers (stall interrupts, polled step scheduler, step timer alarms)
+    static const byte MAX_STEPPERS = 8;
+
+  private:
+
   //Interrupt Handlling
-  //NOTE: this limits the available steppers to 4
-  static void StallInterrupt0();
-  static void StallInterrupt1();
-  static void StallInterrupt2();
-  static void StallInterrupt3();
+  //One glue routine per stepper, generated from a template, all in one table (index = whichDiag)
+  template <byte Stepper> static void StallInterrupt();
+  template <byte... Steppers>
+  static constexpr std::array<void (*)(), sizeof...(Steppers)> makeStallInterrupts(std::integer_sequence<byte, Steppers...>) {
+    return {{ &StallInterrupt<Steppers>... }};
+  }
+  static const std::array<void (*)(), MAX_STEPPERS> stallInterrupts_;
   const byte whichDiag_;
-  static SpeedyStepper4Purr* instance0_;
-  static SpeedyStepper4Purr* instance1_;
-  static SpeedyStepper4Purr* instance2_;
-  static SpeedyStepper4Purr* instance3_;
+  static SpeedyStepper4Purr* instances_[MAX_STEPPERS];
   void StallIndication();
   volatile bool flagStalled_;
 
+  //Step timer handling (hardware alarm, fires on the core that set up the stepper)
+  static int64_t StepInterrupt(alarm_id_t id, void* user_data);
+  static alarm_pool_t* stepAlarmPool_;
+  volatile alarm_id_t stepAlarm_;
+  alarm_callback_t stepInterrupt_;
+  int64_t StepIndication();
+
+  //PIO step generation (one state machine per stepper, program shared by all)
+  static PIO stepPio_;
+  static int stepPioOffset_;
+
 
   public:
 
+    // Step generation modes
+    // NOTE: the step jitter of STEP_TIMER against STEP_POLLED has not been measured on the board yet (the "Step timing"
+    // debug messages, see ReportStepTiming_c1, give it for either mode), so there is no number for the gain.
+    enum StepMode : byte {
+        STEP_POLLED,    // steps are emitted by calling processMovement() (loop1)
+        STEP_TIMER,     // steps are emitted from a hardware alarm interrupt
+        STEP_PIO,       // steps are emitted by a PIO state machine, fed with step periods by DMA
+    };
+
+    // Motion profiles (per move)
+    enum MotionProfile : byte {
+        PROFILE_TRAPEZOID,  // constant acceleration (original)
+        PROFILE_SCURVE,     // jerk limited, the acceleration ramps up and down
+    };
+
+    // Step timing statistics (see getStepTiming), steps by how late they came relative to their period:
+    // <= 1%, <= 10%, <= 50%, <= 100% and > 100% late (early steps count as on time)
+    static const byte STEP_TIMING_BUCKETS = 5;
+
+    struct StepTiming {
+        unsigned long steps;                                // steps measured
+        unsigned long lateSteps[STEP_TIMING_BUCKETS];       // histogram of the lateness
+        unsigned long missedDeadlines;                      // steps more than 10% late
+        unsigned long maxLateness_InUS;                     // latest step
+    };
+
+    // Status of a non-blocking move (see startMoveInSteps)
+    enum MoveStatus : byte {
+        MOVE_RUNNING,
+        MOVE_DONE,
+        MOVE_STALLED,       // done, the motor stalled during the move
+        MOVE_CANCELLED,     // stopped by cancelMove() or replaced by a newer move
+        MOVE_UNKNOWN,       // no such move (0 or an older move)
+    };
+
+    // Handle of a non-blocking move (0 = no move)
+    typedef uint16_t MoveHandle;
+
+    // Called once when a move is done, stalled or cancelled (from pollMove / cancelMove, not from an interrupt)
+    typedef void (*MoveCallback)(void *context, MoveHandle handle, byte moveStatus);
+
+    // Phases of the error handling (see ErrorHandling)
+    enum ErrorHandlingPhase : byte {
+        NOT_HANDLING,
+        CHECKING_STUCK,     // moving away from home, does it stall again?
+        FREEING_SLIDER,     // vibrating the slider with growing amplitude
+        CHECKING_FREED,     // moving away from home again, still stuck?
+        HOMING_WITH_STALL,  // homing with stall detection
+        CHECKING_PATH,      // moving the normal distance, is the path blocked?
+        RETURNING,          // moving back home
+    };
+
+    // Max. number of steps per ramp (accelerating or decelerating) in STEP_PIO mode
+    static const long PIO_RAMP_STEPS = 1024;
+
+    // Max. number of steps of an S-curve ramp (same limit as the PIO period buffer)
+    static const long SCURVE_RAMP_STEPS = PIO_RAMP_STEPS;
+
+    // Max. number of queued move segments
+    static const byte SEGMENT_QUEUE_SIZE = 16;
+
+    // Max. number of stall events kept until they are read (further events are counted as dropped)
+    static const byte STALL_EVENT_BUFFER_SIZE = 16;
+
+    // Stall event, captured by the stall interrupt (DIAG edge)
+    struct StallEvent {
+        unsigned long time_InUS;        // micros() of the DIAG edge
+        long position_InSteps;          // step position at the DIAG edge
+        float stepPeriod_InUS;          // step period at the DIAG edge (0 = standing)
+    };
+
     // public functions
     SpeedyStepper4Purr(const byte whichDiag);
     void connectToPins(byte stepPinNumber, byte directionPinNumber, byte homeEndStopNumber, byte homeDiagPinNumber);
+    void setStepMode(byte stepMode);
+    void setFixedPointRamp(bool fixedPointRamp);
+    void setRampTable(const uint32_t *periodTable, long tableLength, float tableSpeed, float tableAccel);
     void setCurrentPositionInSteps(long currentPositionInSteps);
     long getCurrentPositionInSteps();
     void setSpeedInStepsPerSecond(float speedInStepsPerSecond);
     void setAccelerationInStepsPerSecondPerSecond(float accelerationInStepsPerSecondPerSecond);
+    void setJerkInStepsPerSecondPerSecondPerSecond(float jerkInStepsPerSecondPerSecondPerSecond);
+    void setStepSize(long stepSizeInSteps);
+    long getStepSize();
 	bool getEndstops(bool whichEndstop);
+    void setHomingSpeeds(float approachSpeedInStepsPerSecond, float reprobeSpeedInStepsPerSecond, long backOffDistanceInSteps);
     byte moveToHome(long directionTowardHome, long maxDistanceToMoveInSteps, bool useHomeEndStop);
 	byte ErrorHandling(long directionTowardHome, long maxDistanceToMoveInSteps, long normal_distance);
+    byte getErrorHandlingPhase();
+    byte getErrorHandlingProgress();
     bool moveRelativeInSteps(long distanceToMoveInSteps);
-    void setupRelativeMoveInSteps(long distanceToMoveInSteps);
+    MoveHandle startMoveInSteps(long absolutePositionToMoveToInSteps, MoveCallback onComplete = nullptr, 
+        void *context = nullptr, byte motionProfile = PROFILE_TRAPEZOID);
+    MoveHandle startRelativeMoveInSteps(long distanceToMoveInSteps, MoveCallback onComplete = nullptr, 
+        void *context = nullptr, byte motionProfile = PROFILE_TRAPEZOID);
+    byte pollMove(MoveHandle handle);
+    byte awaitMove(MoveHandle handle);
+    bool cancelMove(MoveHandle handle);
+    void setupRelativeMoveInSteps(long distanceToMoveInSteps, byte motionProfile = PROFILE_TRAPEZOID);
     //void moveToPositionInSteps(long absolutePositionToMoveToInSteps);
-    void setupMoveInSteps(long absolutePositionToMoveToInSteps);
+    void setupMoveInSteps(long absolutePositionToMoveToInSteps, byte motionProfile = PROFILE_TRAPEZOID);
+    bool queueMoveInSteps(long absolutePositionToMoveToInSteps, unsigned int dwellBefore_InMS, 
+        byte motionProfile = PROFILE_TRAPEZOID);
+    bool queueRelativeMoveInSteps(long distanceToMoveInSteps, unsigned int dwellBefore_InMS, 
+        byte motionProfile = PROFILE_TRAPEZOID);
+    long sampleTrajectory(long distanceToMoveInSteps, byte motionProfile, uint32_t *stepPeriods_Q16, long maxSamples);
+    byte getQueuedSegments();
     bool motionComplete();
     //float getCurrentVelocityInStepsPerSecond(); 
     bool processMovement(void);
+    static void runPolledSteps();
+    void stopMovement();
 	bool checkStall();
+    bool popStallEvent(StallEvent &stallEvent);
+    byte getStallEventCount();
+    void clearStallEvents();
+    unsigned long getDroppedStallEvents();
+    unsigned long getMaxStepJitterInUS();
+    void getStepTiming(StepTiming &stepTiming);
+    void resetStepTiming();
+    bool setStepInterrupt(alarm_callback_t stepInterrupt, uint32_t stepPinMask);
 
   private:
 
+    // the step interrupt of steppers with the step pin known at compile time (see SpeedyStepper4PurrFixed.h)
+    template <uint8_t StepPin>
+    friend struct FixedStepInterrupt;
+
+    // ramp of a move: everything the step periods depend on, small enough to plan a
+    // move without touching the running one (see planRamp, sampleTrajectory)
+    struct Ramp {
+        bool useTable;                          // periods are read from a table (RampTable or S-curve)
+        const uint32_t *table;
+        long tableLength;
+        long stepsTaken;
+        bool fixedPoint;                        // periods in Q16 (table or fixed point ramp), else float
+        bool decelerating;
+        long decelerationDistance_InSteps;
+        float initialStepPeriod_InUS;
+        float nextStepPeriod_InUS;
+        float desiredStepPeriod_InUS;
+        float acceleration_InStepsPerUSPerUS;
+        uint32_t nextStepPeriod_Q16;
+        uint32_t desiredStepPeriod_Q16;
+        uint64_t acceleration_Q48;
+
+        void computeNextStepPeriod(long distanceToTarget_InSteps);
+        unsigned long getNextStepPeriodInUS() const;
+        uint32_t getNextStepPeriodQ16() const;
+        void skipSteps(long steps);
+    };
+
+    // private functions
+    int64_t advanceTimedStep();
+    void startStepTimer();
+    void haltMovement();
+    void advanceStep(unsigned long currentTime_InUS);
+    void planMove(long absolutePositionToMoveToInSteps, byte motionProfile);
+    void planRamp(Ramp &moveRamp, long distanceToTravel_InSteps, byte motionProfile);
+    void buildSCurveTable();
+    void setupStepPio();
+    void startStepPio();
+    void updateStepPioPosition();
+    void stopStepPio();
+    bool stepPioDmaBusy();
+    static uint32_t toPioCycles(uint32_t stepPeriod_Q16);
+    bool startNextSegment();
+    long getLivePosition(float &stepPeriod_InUS);
+    long toPulses(long positionInSteps);
+    long toSteps(long positionInPulses);
+    void finishMove(byte moveStatus);
+    void setupErrorMove(long distanceToMoveInSteps);
+    void setupErrorHoming();
+
     // private member variables
+    byte stepMode;
+    bool fixedPointRamp;
+    const uint32_t *rampTable;
+    long rampTableLength;
+    float rampTableSpeed;
+    float rampTableAccel;
+    uint32_t *sCurveTable;
+    long sCurveTableLength;
+    float sCurveTableSpeed;
+    float sCurveTableAccel;
+    float sCurveTableJerk;
     byte stepPin;
     byte directionPin;
+    uint32_t stepPinMask;
+    uint32_t directionPinMask;
 	byte homeEndStop;
 	byte homeDiagPin;
+    // NOTE, position, target, speed, acceleration and ramp below count step pulses, the 
+    // interface counts steps (native resolution), see setStepSize()
+    long stepSize_InSteps;
+    long positionOffset_InSteps;
+    float nativeSpeed_InStepsPerSecond;
+    float nativeAcceleration_InStepsPerSecondPerSecond;
+    float nativeJerk_InStepsPerSecondPerSecondPerSecond;
+    float homingApproachSpeed_InStepsPerSecond;
+    float homingReprobeSpeed_InStepsPerSecond;
+    long homingBackOff_InSteps;
+    float homingSpeed_InStepsPerSecond;
+    MoveHandle moveHandle_;
+    byte moveStatus_;
+    MoveCallback moveCallback_;
+    void *moveContext_;
+    ErrorHandlingPhase errorHandlingPhase;
+    MoveHandle errorMove_;
+    float recoverSpeed_InStepsPerSecond;
+    long recoverTravel_InSteps;
+    long recoverWiggle_InSteps;
+    int recoverWiggleCount;
+    byte recoverHomeEndStop;
     float desiredSpeed_InStepsPerSecond;
     float acceleration_InStepsPerSecondPerSecond;
-    long targetPosition_InSteps;
+    float jerk_InStepsPerSecondPerSecondPerSecond;
+    volatile long targetPosition_InSteps;
     bool startNewMove;
-    float desiredStepPeriod_InUS;
-    long decelerationDistance_InSteps;
     int direction_Scaler;
-    float ramp_InitialStepPeriod_InUS;
-    float ramp_NextStepPeriod_InUS;
+    Ramp ramp;
     unsigned long ramp_LastStepTime_InUS;
-    float acceleration_InStepsPerUSPerUS;
     float currentStepPeriod_InUS;
-    long currentPosition_InSteps;
+    volatile long currentPosition_InSteps;
+    unsigned long maxStepJitter_InUS;
+    StepTiming stepTiming_;
+    uint stepPioSm;
+    int stepDmaChannel[3];
+    uint32_t *stepPeriodBuffer;
+    uint32_t stepCruisePeriod;
+    long stepPioCount[3];
+    long stepPioStartPosition;
+
+    // queued move segments (ring buffer)
+    struct MoveSegment {
+        long targetPosition_InSteps;
+        unsigned int dwellBefore_InMS;
+        byte motionProfile;
+    };
+    MoveSegment segmentQueue[SEGMENT_QUEUE_SIZE];
+    byte segmentHead;
+    byte segmentCount;
+    bool segmentDwelling;
+    unsigned long segmentDwellStart_InMS;
+
+    // stall events (lock-free ring buffer: the stall interrupt only writes the head, 
+    // readers only the tail)
+    StallEvent stallEvents_[STALL_EVENT_BUFFER_SIZE];
+    volatile byte stallEventHead_;
+    volatile byte stallEventTail_;
+    volatile unsigned long droppedStallEvents_;
 
     enum HomingState {
         NOT_HOMING,
         MOVING_AWAY_FROM_ENDSTOP,
         MOVING_TOWARD_ENDSTOP,
+        BACKING_OFF_ENDSTOP,
+        REPROBING_ENDSTOP,
     }; HomingState homingState;
 
     enum HomingResult {
@@ -122,6 +360,7 @@ class SpeedyStepper4Purr
         ERROR_UNKNOWN,
         ERROR_JAMMED,
         ERROR_ENDSTOP,
+        ERROR_IN_PROGRESS,
     }; ErrorState errorState;
 
 };
@@ -0,0 +1,93 @@
+/*
+ * Name:	SpeedyStepper4PurrFixed
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * SpeedyStepper4Purr with step / direction pin, direction to home and microsteps known at compile time (e.g. from the #defines
+ * in PP3000S_CONFIG.h). The step timer interrupt pulses the step pin with a constant mask, pins and settings are checked by
+ * the compiler. Positions, speeds and the ramp are the same as with the runtime class.
+ * NOTE, the direction of a move (direction_Scaler) depends on its target and stays a runtime value; the direction pin is only
+ * written once per move. Polled steps keep the shared scheduler (one SIO write for all motors), PIO steps need no CPU anyway,
+ * so only the step timer (STEP_MODE 1) uses the constant mask.
+ * Usage: SpeedyStepper4PurrFixed<STEP_1, DIR_1, DIR_TO_HOME_1, MIRCO_STEPS> stepper(MOTOR_1); stepper.connectToPins(LIMIT_1, DIAG_1);
+ * A runtime SpeedyStepper4Purr (e.g. the one of FP3000, see FIXED_STEP_PINS) gets the same step interrupt with
+ * FixedStepInterrupt<StepPin>::use(stepper) after connectToPins().
+*/
+
+#ifndef _SPEEDYSTEPPER4PURRFIXED_h
+#define _SPEEDYSTEPPER4PURRFIXED_h
+
+#include "SpeedyStepper4Purr.h"
+#include "FastGPIO.h"
+
+// Step timer interrupt with the step pin mask as a constant
+template <uint8_t StepPin>
+struct FixedStepInterrupt {
+
+	static_assert(StepPin < 30, "FixedStepInterrupt: the RP2040 has GPIO 0..29");
+
+	using StepPins = SioPins<PinMask<StepPin>::value>;
+
+	// Step timer glue routine (user_data is the stepper)
+	static int64_t StepInterrupt(alarm_id_t id, void *user_data) {
+		int64_t nextStepPeriod_InUS;
+
+		StepPins::high();
+		nextStepPeriod_InUS = static_cast<SpeedyStepper4Purr *>(user_data)->advanceTimedStep();
+		StepPins::low();
+
+		return nextStepPeriod_InUS;
+	}
+
+	// Use it for a stepper connected to StepPin
+	//  Exit:  false returned if the stepper is connected to another step pin
+	static bool use(SpeedyStepper4Purr &stepper) {
+		return stepper.setStepInterrupt(StepInterrupt, StepPins::mask);
+	}
+};
+
+template <uint8_t StepPin, uint8_t DirPin, long DirHome, uint16_t MicroSteps>
+class SpeedyStepper4PurrFixed : public SpeedyStepper4Purr {
+
+	static_assert(StepPin < 30 && DirPin < 30, "SpeedyStepper4PurrFixed: the RP2040 has GPIO 0..29");
+	static_assert(StepPin != DirPin, "SpeedyStepper4PurrFixed: step and direction pin are the same");
+	static_assert(DirHome == 1 || DirHome == -1, "SpeedyStepper4PurrFixed: direction to home is 1 or -1");
+	static_assert(MicroSteps >= 1 && MicroSteps <= 256 && (MicroSteps & (MicroSteps - 1)) == 0,
+		"SpeedyStepper4PurrFixed: microsteps are a power of 2 up to 256");
+
+public:
+
+	using StepPins = typename FixedStepInterrupt<StepPin>::StepPins;
+	using DirPins = SioPins<PinMask<DirPin>::value>;
+	static constexpr long dirHome = DirHome;
+	static constexpr uint16_t microSteps = MicroSteps;
+
+	SpeedyStepper4PurrFixed(const byte whichDiag) : SpeedyStepper4Purr(whichDiag) {}
+
+	// Connect to the pins (step and direction pin are given by the template)
+	void connectToPins(byte homeEndStopNumber, byte homeDiagPinNumber) {
+		SpeedyStepper4Purr::connectToPins(StepPin, DirPin, homeEndStopNumber, homeDiagPinNumber);
+		FixedStepInterrupt<StepPin>::use(*this);
+	}
+
+	// Home toward DirHome
+	byte moveToHome(long maxDistanceToMoveInSteps, bool useHomeEndStop) {
+		return SpeedyStepper4Purr::moveToHome(DirHome, maxDistanceToMoveInSteps, useHomeEndStop);
+	}
+
+	// Recover from a stepper error, homing toward DirHome (see SpeedyStepper4Purr::ErrorHandling)
+	byte ErrorHandling(long maxDistanceToMoveInSteps, long normal_distance) {
+		return SpeedyStepper4Purr::ErrorHandling(DirHome, maxDistanceToMoveInSteps, normal_distance);
+	}
+
+	// Set the step size for the driver's microsteps (see SpeedyStepper4Purr::setStepSize), e.g. setDriverMicrosteps<8>()
+	template <uint16_t DriverMicroSteps>
+	void setDriverMicrosteps() {
+		static_assert(DriverMicroSteps >= 1 && MicroSteps % DriverMicroSteps == 0,
+			"SpeedyStepper4PurrFixed: driver microsteps have to divide the microsteps");
+		setStepSize(MicroSteps / DriverMicroSteps);
+	}
+};
+
+#endif
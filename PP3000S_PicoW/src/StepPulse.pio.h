@@ -0,0 +1,40 @@
+// -------------------------------------------------- //
+// This file is autogenerated by pioasm; do not edit! //
+// -------------------------------------------------- //
+
+#pragma once
+
+#if !PICO_NO_HARDWARE
+#include "hardware/pio.h"
+#endif
+
+// ---------- //
+// step_pulse //
+// ---------- //
+
+#define step_pulse_wrap_target 0
+#define step_pulse_wrap 3
+
+static const uint16_t step_pulse_program_instructions[] = {
+            //     .wrap_target
+    0x80a0, //  0: pull   block           side 0     
+    0x6020, //  1: out    x, 32           side 0     
+    0x0042, //  2: jmp    x--, 2          side 0     
+    0x1780, //  3: jmp    y--, 0          side 1 [7] 
+            //     .wrap
+};
+
+#if !PICO_NO_HARDWARE
+static const struct pio_program step_pulse_program = {
+    .instructions = step_pulse_program_instructions,
+    .length = 4,
+    .origin = -1,
+};
+
+static inline pio_sm_config step_pulse_program_get_default_config(uint offset) {
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + step_pulse_wrap_target, offset + step_pulse_wrap);
+    sm_config_set_sideset(&c, 1, false, false);
+    return c;
+}
+#endif
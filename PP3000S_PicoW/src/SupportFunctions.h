@@ -19,19 +19,13 @@ void checkWifi();
 
 // Core 1:
 void ReceiveWarningsErrors_c1(FP3000& device, byte deviceNumber);
+void ReportRecovery_c1(FP3000& device, byte deviceNumber);
+void ReportStepTiming_c1(FP3000& device, byte deviceNumber);
+void ReportAccuracy_c1(FP3000& device, byte deviceNumber);
 void Power_c1(bool power);
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++++++
-// 2x CAT
-#ifdef NAME_CAT_2
-void PopData_c1(byte& modeToSet, float& amountToFeed_1, float& amountToFeed_2);
-void checkFillLevel_c1(uint16_t lastAmount, uint16_t lastAmount2);
-#else
-// 1x CAT
-void checkFillLevel_c1(uint16_t lastAmount1);
-void PopData_c1(byte& modeToSet, float& amountToFeed_1);
-#endif
-// +++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++++++
+void PopData_c1(byte& modeToSet, float amountToFeed[]);
+void checkFillLevel_c1(uint16_t lastAmount);
 
 // Shared:
 void PackPushData(uint8_t type, uint8_t device, uint16_t info);
@@ -65,52 +59,30 @@ void checkWifi() {
 // Checks if it is time to feed via the hardware timer. If it is time, the feeding command is sent to Core 1.
 void CheckTimeAndFeed_c0() {
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-	byte amountCat1;
-	byte amountCat2;
-	PicoRTC.TimeToFeed(amountCat1, amountCat2);
-	if (amountCat1 > 0 || amountCat2 > 0) {
-
-		// Reset warning message
-		DefaultInfo_c0(true);
+	// Note, the schedule holds the amounts of two cats, channels beyond FEED_CHANNELS are ignored.
+	byte amounts[2];
+	PicoRTC.TimeToFeed(amounts[0], amounts[1]);
 
-		// Send feeding command to Core 1
-		// Note, priming takes a few cycles for core 1 to finish, so the second feeding
-		// command/amount will still be processed before the actual feeding begins.
-		PackPushData('F', SCALE_1, byteToUint16(amountCat1));
-		PackPushData('F', SCALE_2, byteToUint16(amountCat2));
-
-		DEBUG_DEBUG("Feeding command sent to Core 1");
-		DEBUG_DEBUG("Amount Cat 1: %dg", amountCat1);
-		DEBUG_DEBUG("Amount Cat 2: %dg", amountCat2);
+	bool feed = false;
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		feed |= amounts[c] > 0;
 	}
 
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-
-	byte amountCat1;
-	PicoRTC.TimeToFeed(amountCat1);
-	if (amountCat1 > 0) {
+	if (feed) {
 
 		// Reset warning message
 		DefaultInfo_c0(true);
 
 		// Send feeding command to Core 1
-		// Note, priming takes a few cycles for core 1 to finish, so the second feeding
-		// command/amount will still be processed before the actual feeding begins.
-		PackPushData('F', SCALE_1, byteToUint16(amountCat1));
-
+		// Note, priming takes a few cycles for core 1 to finish, so the further feeding
+		// commands/amounts will still be processed before the actual feeding begins.
 		DEBUG_DEBUG("Feeding command sent to Core 1");
-		DEBUG_DEBUG("Amount Cat 1: %dg", amountCat1);
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			PackPushData('F', channelConfig[c].scale, byteToUint16(amounts[c]));
+			DEBUG_DEBUG("Amount Cat %d: %dg", c + 1, amounts[c]);
+		}
 	}
 
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++++
-// ----------------------------------------------------------------------------------------------------
-
 	// Update daily schedule to Home Assistant
 	reportDailySchedule_c0();
 }
@@ -121,81 +93,25 @@ void CheckTimeAndFeed_c0() {
 void reportDailySchedule_c0() {
 	// Note, updates should actually only be send when values actually change (see ArduinoHA.h).
 
-// ----------------------------------------------------------------------------------------------------
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-	// Update Amounts
+	// Update Amounts and Treat Amounts
 	// ========================================================================================
-	byte amountCat1 = 0;
-	byte amountCat2 = 0;
-
-	for (int i = 0; i < 4; i++) {
-		amountCat1 += PicoRTC.schedule.feedingAmounts[i][0];
-		amountCat2 += PicoRTC.schedule.feedingAmounts[i][1];
-	}
+	for (byte c = 0; c < FEED_CHANNELS; c++) {
+		byte amountCat = 0;
 
-	// Send total daily feeding amounts to Home Assistant
-	HAFeedingAmountCat1.setState(amountCat1);
-	HAFeedingAmountCat2.setState(amountCat2);
-
-	// Send single feeding amounts to Home Assistant
-	// ======================================================================
-	// Cat 1
-	HAFeedingAmountCat1Time1.setState(PicoRTC.schedule.feedingAmounts[0][0]);
-	HAFeedingAmountCat1Time2.setState(PicoRTC.schedule.feedingAmounts[1][0]);
-	HAFeedingAmountCat1Time3.setState(PicoRTC.schedule.feedingAmounts[2][0]);
-	HAFeedingAmountCat1Time4.setState(PicoRTC.schedule.feedingAmounts[3][0]);
-	// Cat 2
-	HAFeedingAmountCat2Time1.setState(PicoRTC.schedule.feedingAmounts[0][1]);
-	HAFeedingAmountCat2Time2.setState(PicoRTC.schedule.feedingAmounts[1][1]);
-	HAFeedingAmountCat2Time3.setState(PicoRTC.schedule.feedingAmounts[2][1]);
-	HAFeedingAmountCat2Time4.setState(PicoRTC.schedule.feedingAmounts[3][1]);
-	// ======================================================================
-	// ========================================================================================
-
-	// Update Times
-	// ========================================================================================
-	// Hours
-	HAFeedingHour1.setState(PicoRTC.schedule.feedingTimes[0].hour);
-	HAFeedingHour2.setState(PicoRTC.schedule.feedingTimes[1].hour);
-	HAFeedingHour3.setState(PicoRTC.schedule.feedingTimes[2].hour);
-	HAFeedingHour4.setState(PicoRTC.schedule.feedingTimes[3].hour);
-	// Minutes
-	HAFeedingMin1.setState(PicoRTC.schedule.feedingTimes[0].min);
-	HAFeedingMin2.setState(PicoRTC.schedule.feedingTimes[1].min);
-	HAFeedingMin3.setState(PicoRTC.schedule.feedingTimes[2].min);
-	HAFeedingMin4.setState(PicoRTC.schedule.feedingTimes[3].min);
-	// ========================================================================================
+		for (int i = 0; i < 4; i++) {
+			amountCat += PicoRTC.schedule.feedingAmounts[i][c];
 
-	// Update Treat Amounts
-	// ========================================================================================
-	HATreatAmount1.setState(treatAmount1);
-	HATreatAmount2.setState(treatAmount2);
-	// ========================================================================================
+			// Send single feeding amounts to Home Assistant
+			HACat[c].amountAt[i].setState(PicoRTC.schedule.feedingAmounts[i][c]);
+		}
 
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-	// Update Amounts
-	// ========================================================================================
-	byte amountCat1 = 0;
+		// Send total daily feeding amount to Home Assistant
+		HACat[c].daily.setState(amountCat);
 
-	for (int i = 0; i < 4; i++) {
-		amountCat1 += PicoRTC.schedule.feedingAmounts[i][0];
+		// Send treat amount to Home Assistant
+		HACat[c].treat.setState(treatAmount[c]);
 	}
-
-	// Send total daily feeding amounts to Home Assistant
-	HAFeedingAmountCat1.setState(amountCat1);
-
-	// Send single feeding amounts to Home Assistant
-	// ======================================================================
-	// Cat 1
-	HAFeedingAmountCat1Time1.setState(PicoRTC.schedule.feedingAmounts[0][0]);
-	HAFeedingAmountCat1Time2.setState(PicoRTC.schedule.feedingAmounts[1][0]);
-	HAFeedingAmountCat1Time3.setState(PicoRTC.schedule.feedingAmounts[2][0]);
-	HAFeedingAmountCat1Time4.setState(PicoRTC.schedule.feedingAmounts[3][0]);
-	// ======================================================================
 	// ========================================================================================
 
 	// Update Times
@@ -212,15 +128,6 @@ void reportDailySchedule_c0() {
 	HAFeedingMin4.setState(PicoRTC.schedule.feedingTimes[3].min);
 	// ========================================================================================
 
-	// Update Treat Amounts
-	// ========================================================================================
-	HATreatAmount1.setState(treatAmount1);
-	// ========================================================================================
-
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++++
-// ----------------------------------------------------------------------------------------------------
-
 }
 // ---------------------------------------------------------------------------------------------------*
 
@@ -331,22 +238,59 @@ void PopAndDebug_c0() {
 				float finfo = uint16ToFloat(info);
 				DEBUG_DEBUG("Scale (device#) %d: %.2fg", device, finfo);
 				info = info / 100; // Convert to grams
-				if (device == SCALE_1) {
-					HAScale1.setValue(info);
+				for (byte c = 0; c < FEED_CHANNELS; c++) {
+					if (device == channelConfig[c].scale) {
+						HACat[c].scale.setValue(info);
+					}
 				}
 
-// ++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-				else if (device == SCALE_2) {
-					HAScale2.setValue(info);
+				break;
+			}
+			case 'D': {
+				// Step Timing Messages (how late the steps came, see ReportStepTiming_c1)
+				static const char* stepTimingField[] = {"<=1% late", "<=10% late", "<=50% late", "<=100% late", ">100% late",
+					"missed deadlines", "max. lateness (us)"};
+				byte field = info >> 12;
+				if (field < 5) {
+					DEBUG_INFO("Step timing device %d: %s %d per mille", device, stepTimingField[field], info & 0x0FFF);
+				}
+				else if (field < 7) {
+					DEBUG_INFO("Step timing device %d: %s %d", device, stepTimingField[field], info & 0x0FFF);
 				}
-#endif
-// ++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++
-// --------------------------------------------------------------------------------
-
 				break;
 			}
+			case 'P':
+				// Trajectory Check Messages (largest excess over SPEED / ACCEL, 255 = steps missing)
+				DEBUG_INFO("Trajectory device %d: %d%% over limits", device, info);
+				break;
+			case 'N':
+				// Trajectory Planning Time Messages
+				DEBUG_INFO("Trajectory device %d: %dns per step", device, info);
+				break;
+			case 'R':
+				// Error Handling Progress Messages (phase, vibration amplitude)
+				DEBUG_INFO("Recovery device %d: phase %d, %d%%", device, info >> 8, info & 0xFF);
+				break;
+			case 'B':
+				// Dosing Bias Messages (mean error of the feedings, signed in 0.01g)
+				DEBUG_INFO("Dosing scale %d: bias %.2fg", device, (int16_t)info / 100.0);
+				break;
+			case 'V':
+				// Dosing Deviation Messages (standard deviation of the error in 0.01g)
+				DEBUG_INFO("Dosing scale %d: deviation %.2fg", device, uint16ToFloat(info));
+				break;
+			case 'H':
+				// Homing Duration Messages
+				DEBUG_INFO("Homing device %d: %dms", device, info);
+				break;
+			case 'J':
+				// Step Jitter Messages (largest deviation of a step from its intended time)
+				DEBUG_INFO("Step jitter device %d: %dus", device, info);
+				break;
+			case 'T':
+				// Stall Position Messages (distance from home of the first stall)
+				DEBUG_WARNING("Stall device %d at step %d", device, info);
+				break;
 			case 'C':
 				// Calibration Messages
 				DEBUG_DEBUG("Calibration Scale %d: %s", device, CALIBRATION_MESSAGES[info]);
@@ -460,70 +404,71 @@ void ReceiveWarningsErrors_c1(FP3000& device, byte deviceNumber) {
     if (info_E != 0) {
         PackPushData('E', deviceNumber, info_E);
     }
+
+    // Report where the (first) stall happened
+    long stallPosition = device.StallPosition();		// (FP3000)
+    if ((info_W != 0 || info_E != 0) && stallPosition >= 0) {
+        PackPushData('T', deviceNumber, min(stallPosition, 65535L));
+    }
 }
 // ---------------------------------------------------------------------------------------------------*
 
-// Function to pop data from Core 0
+// Function to report how late the steps came since the last report
 // ----------------------------------------------------------------------------------------------------
+void ReportStepTiming_c1(FP3000& device, byte deviceNumber) {
 
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-void PopData_c1(byte& modeToSet, float& amountToFeed_1, float& amountToFeed_2) {
+    SpeedyStepper4Purr::StepTiming stepTiming;
+    device.PopStepTiming(stepTiming);		// (FP3000)
+    if (stepTiming.steps == 0) {
+        return;								// No steps timed (e.g. STEP_MODE 2)
+    }
 
-	char type;
-	uint8_t device;
-	uint16_t info;
-	uint32_t data;
-	bool recError = false;
+    // Field (high 4 bits) and value (low 12 bits): 0..4 - histogram (per mille of the steps), 5 - missed deadlines,
+    // 6 - max. lateness (us)
+    for (byte i = 0; i < SpeedyStepper4Purr::STEP_TIMING_BUCKETS; i++) {
+        uint16_t perMille = stepTiming.lateSteps[i] * 1000ULL / stepTiming.steps;
+        PackPushData('D', deviceNumber, (i << 12) | perMille);
+    }
+    PackPushData('D', deviceNumber, (5 << 12) | min(stepTiming.missedDeadlines, 4095UL));
+    PackPushData('D', deviceNumber, (6 << 12) | min(stepTiming.maxLateness_InUS, 4095UL));
+}
+// ---------------------------------------------------------------------------------------------------*
 
-	// Check if data is available
-	int dataCount = rp2040.fifo.available();
+// Function to report the learned accuracy of the feedings (bias and standard deviation)
+// ----------------------------------------------------------------------------------------------------
+void ReportAccuracy_c1(FP3000& device, byte deviceNumber) {
+
+    float bias;
+    float deviation;
+    uint16_t feedings;
+    device.DoseAccuracy(bias, deviation, feedings);		// (FP3000)
+    if (feedings == 0) {
+        return;
+    }
 
-	for (int i = 0; i < dataCount; i++) {
-		if (rp2040.fifo.pop_nb(&data)) {
+    // Bias signed in 0.01g (+-327g), deviation in 0.01g (see floatToUint16)
+    PackPushData('B', deviceNumber, (uint16_t)(int16_t)constrain(lround(bias * 100), -32767L, 32767L));
+    PackPushData('V', deviceNumber, floatToUint16(min(deviation, 655.0f)));
+}
+// ---------------------------------------------------------------------------------------------------*
 
-			// Unpack data from FIFO
-			unpackData(data, type, device, info);
+// Function to report the progress of an error handling (e.g. freeing a jammed slider)
+// ----------------------------------------------------------------------------------------------------
+void ReportRecovery_c1(FP3000& device, byte deviceNumber) {
 
-			// Receive commands from Core 0
-			if (type == 'M') {	// Reveice mode
-				modeToSet = static_cast<byte>(info);
-			}
-			else if (type == 'F') {
-				modeToSet = FEED;
+    // Only send when the progress changed (0 = error handling finished)
+    uint16_t progress;
+    if (device.RecoveryProgress(progress)) {		// (FP3000)
+        PackPushData('R', deviceNumber, progress);
+    }
+}
+// ---------------------------------------------------------------------------------------------------*
 
-				if (device == SCALE_1) {
-					amountToFeed_1 = uint16ToFloat(info);
-				}
-				else if (device == SCALE_2) {
-					amountToFeed_2 = uint16ToFloat(info);
-				}
-				else {
-					// Unexpected data (FIFO error)
-					recError = true;
-				}
-			}
-			else {
-				// Unexpected data (FIFO error)
-				recError = true;
-			}
-		}
-		else {
-			// Unexpected FIFO error
-			recError = true;
-		}
-	}
+// Function to pop data from Core 0
+// ----------------------------------------------------------------------------------------------------
 
-	if (recError) {
-		// This is for an unexpected error.
-		// 99 - only a placeholder, 7 - FIFO error
-		PackPushData('E', 99, 7);
-	}
-}
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-void PopData_c1(byte& modeToSet, float& amountToFeed_1) {
+// Amounts are received per scale (device) and stored at the index of its feeding channel.
+void PopData_c1(byte& modeToSet, float amountToFeed[]) {
 
 	char type;
 	uint8_t device;
@@ -547,10 +492,14 @@ void PopData_c1(byte& modeToSet, float& amountToFeed_1) {
 			else if (type == 'F') {
 				modeToSet = FEED;
 
-				if (device == SCALE_1) {
-					amountToFeed_1 = uint16ToFloat(info);
+				bool known = false;
+				for (byte c = 0; c < FEED_CHANNELS; c++) {
+					if (device == channelConfig[c].scale) {
+						amountToFeed[c] = uint16ToFloat(info);
+						known = true;
+					}
 				}
-				else {
+				if (!known) {
 					// Unexpected data (FIFO error)
 					recError = true;
 				}
@@ -572,9 +521,6 @@ void PopData_c1(byte& modeToSet, float& amountToFeed_1) {
 		PackPushData('E', 99, 7);
 	}
 }
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++++
-// ----------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------*
 
 // Power On/Off unused devices
@@ -673,80 +619,9 @@ uint16_t byteToUint16(uint8_t value) {
 // Report fill level
 // ----------------------------------------------------------------------------------------------------
 // Function that uses the Side Fill Sensor to report when the food is running low and if available,
-// reports a very approximate fill level.
-
-// +++++++++++++++++++++++++++ DIFFERENTIATE BETWEEN 1x AND 2x CATS +++++++++++++++++++++++++++++++++++
-#ifdef NAME_CAT_2
-// IF 2x CATS +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-void checkFillLevel_c1(uint16_t lastAmount1, uint16_t lastAmount2) {
-	
-	static bool lowLevel = false;
-	static bool lastState = false;
-	static uint16_t feedingSinceTop = HIGH_CAP;
-
-	// Side Fill Sensor
-	// ========================================================================================
-	// In case a side fill sensor is available, this function only reports when food is low.
-	if (SIDE_FILL) {
-		if (mcp.getPin(SIDE_IR_1, A) || mcp.getPin(SIDE_IR_2, A)) {
-			PackPushData('W', 99, 8);	// 8 = Refill food (99 = no specific device)
-			lowLevel = true;
-		}
-		else if (lowLevel) {
-			PackPushData('W', 99, 0);	// 0 = OK
-			lowLevel = false;
-		}
-	}
-	// ========================================================================================
-
-	// Top Sensor
-	// ========================================================================================
-	// This function approximates the fill level based on the top and side sensor readings
-	// (when available). When the top sensor reads full, then the max. remaining feedeings are
-	// approximated with the HIGH_CAP value (e.g. capacity = 1000g, daily feeding = 100g, then
-	// ">10" days are left). When the top sensor switches from full to not full, then remaining
-	// feedinngs are estimated by subtracting the current weight from the HIGH_CAP value. Then,
-	// if this substraction shows 0, the the remaining feedings will show the min. value,
-	// calculated with the LOW_CAP figure (e.g. "<1 day" left). This is a very rough estimation
-	// and should be used with caution. Note, sensor signals are inverted.
-
-	if (SIDE_FILL && TOP_FILL) {
-		uint16_t remainingDays = 0;
-		uint16_t amountCat1 = 0;
-		uint16_t amountCat2 = 0;
-		for (int i = 0; i < 4; i++) {
-			amountCat1 += PicoRTC.schedule.feedingAmounts[i][0];
-			amountCat2 += PicoRTC.schedule.feedingAmounts[i][1];
-		}
-		uint16_t maxPerDay = (amountCat1 > amountCat2) ? amountCat1 : amountCat2;
-
-		if (lowLevel) {
-			remainingDays = LOW_CAP / maxPerDay;
-			PackPushData('2', 0, remainingDays);	// '2' = Message type: "Warning! < "
-		}
-		else if (mcp.getPin(TOP_IR_1, A) || mcp.getPin(TOP_IR_2, A)) {
-			if (lastState) {
-				lastState = false;
-				feedingSinceTop = 0;
-				remainingDays = HIGH_CAP / maxPerDay;
-			}
-			else {
-				feedingSinceTop += (lastAmount1 > lastAmount2) ? lastAmount1 : lastAmount2;
-				remainingDays = (feedingSinceTop >= HIGH_CAP) ? LOW_CAP / maxPerDay : (HIGH_CAP - feedingSinceTop) / maxPerDay;
-			}
-			PackPushData('1', 0, remainingDays);	// '1' = Message type: "~ "
-		}
-		else {
-			lastState = true;
-			remainingDays = HIGH_CAP / maxPerDay;
-			PackPushData('0', 0, remainingDays);	// '0' = Message type: "> "
-		}
-	}
-	// ========================================================================================
-}
-#else
-// ELSE 1x CAT ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
-void checkFillLevel_c1(uint16_t lastAmount1) {
+// reports a very approximate fill level. The sensors of all feeding channels are combined (any channel low =
+// low), lastAmount is the largest amount fed to a channel.
+void checkFillLevel_c1(uint16_t lastAmount) {
 	static bool lowLevel = false;                    // Low level warning
 	static bool lastState = false;                   // Last state of the top sensor
 	static uint16_t feedingSinceTop = HIGH_CAP;      // Feeding since full (assume ~empty at start)
@@ -756,7 +631,10 @@ void checkFillLevel_c1(uint16_t lastAmount1) {
 	// ========================================================================================
 	// In case a side fill sensor is available, this function only reports when food is low.
 	if (SIDE_FILL) {
-		bool readLowLevel = EXPANDER ? mcp.getPin(SIDE_IR_1, A) : digitalRead(SIDE_IR_1);
+		bool readLowLevel = false;
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			readLowLevel |= EXPANDER ? mcp.getPin(channelConfig[c].sideIR, A) : digitalRead(channelConfig[c].sideIR);
+		}
 		if (readLowLevel && !lowLevel) {
 			PackPushData('W', 99, 8);  // 8 = Refill food (99 = no specific device)
 			lowLevel = true;
@@ -780,19 +658,26 @@ void checkFillLevel_c1(uint16_t lastAmount1) {
 	// and should be used with caution. Note, sensor signals are inverted.
 	if (SIDE_FILL && TOP_FILL) {
 		uint16_t remainingDays = 0;
-		uint16_t amountCat1 = 0;
+		uint16_t maxPerDay = 0;
 
-		// Calculate total daily feeding amount
-		for (int i = 0; i < 4; i++) {
-			amountCat1 += PicoRTC.schedule.feedingAmounts[i][0];
+		// Calculate total daily feeding amount (of the cat eating the most)
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			uint16_t amountCat = 0;
+			for (int i = 0; i < 4; i++) {
+				amountCat += PicoRTC.schedule.feedingAmounts[i][c];
+			}
+			maxPerDay = max(maxPerDay, amountCat);
 		}
 
 		// Read top sensor (inverted signal)
-		bool readHighLevel = EXPANDER ? mcp.getPin(TOP_IR_1, A) : digitalRead(TOP_IR_1);
+		bool readHighLevel = false;
+		for (byte c = 0; c < FEED_CHANNELS; c++) {
+			readHighLevel |= EXPANDER ? mcp.getPin(channelConfig[c].topIR, A) : digitalRead(channelConfig[c].topIR);
+		}
 
 		// Check fill level
 		if (lowLevel) {                                // Food is below low level sensor
-			remainingDays = LOW_CAP / amountCat1;
+			remainingDays = LOW_CAP / maxPerDay;
 			PackPushData('2', 0, remainingDays);    // '2' = Message type: "Warning! < "
 			wasLowLevel = true;                     // Set wasLowLevel to true
 		}
@@ -800,11 +685,11 @@ void checkFillLevel_c1(uint16_t lastAmount1) {
 			if (lastState) {                        // Food was full (now not full); first time calculation from full
 				lastState = false;
 				feedingSinceTop = 0;
-				remainingDays = HIGH_CAP / amountCat1;
+				remainingDays = HIGH_CAP / maxPerDay;
 			}
 			else {                                // Food was not full; calculate remaining days based on feeding since full
-				feedingSinceTop += lastAmount1;
-				remainingDays = (feedingSinceTop >= HIGH_CAP) ? LOW_CAP / amountCat1 : (HIGH_CAP - feedingSinceTop) / amountCat1;
+				feedingSinceTop += lastAmount;
+				remainingDays = (feedingSinceTop >= HIGH_CAP) ? LOW_CAP / maxPerDay : (HIGH_CAP - feedingSinceTop) / maxPerDay;
 			}
 			PackPushData('1', 0, remainingDays);    // '1' = Message type: "~ "
 			wasLowLevel = false;                    // Reset wasLowLevel to false
@@ -812,22 +697,20 @@ void checkFillLevel_c1(uint16_t lastAmount1) {
 		else {                                    // Food is above top sensor (full)
 			lastState = true;
 			feedingSinceTop = 0;                    // Reset feedingSinceTop when full
-			remainingDays = HIGH_CAP / amountCat1;
+			remainingDays = HIGH_CAP / maxPerDay;
 			PackPushData('0', 0, remainingDays);    // '0' = Message type: "> "
 			wasLowLevel = false;                    // Reset wasLowLevel to false
 		}
 
 		// Check if food is above side sensor but below top sensor
 		if (!lowLevel && !readHighLevel && wasLowLevel) {
-			remainingDays = LOW_CAP / amountCat1;   // Assume minimum capacity since exact amount is unknown
+			remainingDays = LOW_CAP / maxPerDay;   // Assume minimum capacity since exact amount is unknown
 			PackPushData('0', 0, remainingDays);    // '0' = Message type: "> "
 			wasLowLevel = false;                    // Reset wasLowLevel to false
 		}
 	}
 	// ========================================================================================
 }
-#endif
-// +++++++++++++++++++++++++ END OF DIFFERENTIATE BETWEEN 1x AND 2x CATS ++++++++++++++++++++++++++++++
 // ----------------------------------------------------------------------------------------------------
 // ---------------------------------------------------------------------------------------------------*
 // END OF SUPPORT FUNCTIONS - SHARED ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
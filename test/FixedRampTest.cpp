@@ -0,0 +1,82 @@
+/*
+ * Name:	FixedRampTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Host check of the fixed point ramp (FIXED_RAMP) against the float ramp it replaces: for the speeds the PurrPleaser
+ * moves at (SPEED, the slowest adaptive stroke at SPEED/2, both homing speeds) and the feeding / MoveCycleAccurate()
+ * distances, every planned step period of the fixed point ramp has to be within 1us of the float one.
+ * Also prints the cost per step of both ramps (host time; the RP2040 has no FPU, so on the target the float ramp is
+ * slower by much more than here).
+*/
+
+#include "HostTest.h"
+
+#define MAX_PERIOD_DIFF		65536		// 1us as Q16
+
+// Speeds checked (steps/s)
+static const float speeds[] = {
+	SPEED,
+	SPEED / 2,						// Slowest adaptive feeding stroke (MAX_STROKE_SPEED)
+	HOMING_FAST_SPEED,
+	HOMING_SLOW_SPEED
+};
+
+// Distances checked (steps)
+static const long distances[] = {
+	1, 2, 3,
+	STD_FEED_DIST / 100,			// Smallest MoveCycleAccurate() step
+	STD_FEED_DIST / 10,				// Largest MoveCycleAccurate() step (ACCURATE_MAX_STEP)
+	HOMING_BACKOFF,
+	STD_FEED_DIST,
+	PUMP_MAX_RANGE
+};
+
+static SpeedyStepper4Purr stepper(0);
+
+int main() {
+	long worstDiff = 0;
+
+	for (float speed : speeds) {
+		if (speed <= 0) {
+			continue;
+		}
+		for (long distance : distances) {
+			setupStepper(stepper, KIND_FLOAT, speed);
+			std::vector<uint32_t> floatPeriods = plannedPeriods(stepper, distance, KIND_FLOAT);
+			setupStepper(stepper, KIND_FIXED, speed);
+			std::vector<uint32_t> fixedPeriods = plannedPeriods(stepper, distance, KIND_FIXED);
+
+			CHECK(floatPeriods.size() == fixedPeriods.size(), "%.0f steps/s, %ld steps: %ld float and %ld fixed point steps",
+				speed, distance, (long) floatPeriods.size(), (long) fixedPeriods.size());
+			long diffSteps = 0;
+			long maxDiff = 0;
+			for (size_t i = 0; i < floatPeriods.size() && i < fixedPeriods.size(); i++) {
+				long diff = labs((long) fixedPeriods[i] - (long) floatPeriods[i]);
+				maxDiff = max(maxDiff, diff);
+				if (diff > MAX_PERIOD_DIFF) {
+					diffSteps++;
+				}
+			}
+			CHECK(diffSteps == 0, "%.0f steps/s, %ld steps: %ld steps more than 1us off (up to %.3fus)",
+				speed, distance, diffSteps, maxDiff / 65536.0);
+			worstDiff = max(worstDiff, maxDiff);
+		}
+	}
+	printf("Largest difference fixed point to float: %.4fus\n", worstDiff / 65536.0);
+
+	// Cost per step of planning a feeding stroke
+	printf("Planning cost per step (host):\n");
+	for (byte kind = KIND_FLOAT; kind <= KIND_FIXED; kind++) {
+		setupStepper(stepper, kind);
+		std::vector<uint32_t> periods(STD_FEED_DIST);
+		double ns = nsPerCall(2000, [&]() {
+			stepper.sampleTrajectory(STD_FEED_DIST, motionProfile(kind), periods.data(), periods.size());
+		});
+		printf("  %-12s %6.2f ns/step\n", rampName(kind), ns / STD_FEED_DIST);
+	}
+
+	printf("%s (%d failed checks)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * Name:	FixedStepPinTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Host check of the step interrupt with the step pin known at compile time (SpeedyStepper4PurrFixed.h, FIXED_STEP_PINS):
+ * a step timer move (STEP_MODE 1, alarms fired by the test) pulses the fixed step pin and steps exactly like the runtime
+ * step interrupt, and the fixed interrupt is refused for a stepper on another step pin.
+ * Also prints the cost per step of both interrupts (host time; the code size / cycles on the RP2040 are not measured).
+*/
+
+#include "HostTest.h"
+#include "SpeedyStepper4PurrFixed.h"
+
+static SpeedyStepper4Purr stepper(0);
+static SpeedyStepper4PurrFixed<STEP_1, DIR_1, DIR_TO_HOME_1, MIRCO_STEPS> fixedStepper(1);
+
+// Run a step timer move, return the step periods (US) and check that every step pulses the given pins only
+static std::vector<int64_t> runTimerMove(SpeedyStepper4Purr &timerStepper, long distance, uint32_t stepPinMask,
+	const char *name) {
+	std::vector<int64_t> periods;
+	long wrongPulses = 0;
+
+	timerStepper.setStepMode(SpeedyStepper4Purr::STEP_TIMER);
+	timerStepper.setCurrentPositionInSteps(0);
+	timerStepper.stopMovement();
+	timerStepper.setupMoveInSteps(distance);
+	timerStepper.processMovement();
+	uint64_t lastDue = HostAlarm::due_InUS;
+	while (HostAlarm::armed && (long) periods.size() < distance) {
+		sio_hw->gpio_set = 0;
+		sio_hw->gpio_clr = 0;
+		HostAlarm::fire();
+		if (sio_hw->gpio_set != stepPinMask || sio_hw->gpio_clr != stepPinMask) {
+			wrongPulses++;
+		}
+		periods.push_back((int64_t) (HostAlarm::due_InUS - lastDue));
+		lastDue = HostAlarm::due_InUS;
+	}
+	CHECK(!HostAlarm::armed, "%s: alarm still armed after %ld steps", name, distance);
+	CHECK(timerStepper.motionComplete(), "%s: move not complete", name);
+	CHECK(timerStepper.getCurrentPositionInSteps() == distance, "%s: stopped at %ld", name,
+		timerStepper.getCurrentPositionInSteps());
+	CHECK(wrongPulses == 0, "%s: %ld steps pulsed other pins", name, wrongPulses);
+	return periods;
+}
+
+int main() {
+	const uint32_t stepPinMask = 1ul << STEP_1;
+
+	// The template sets its interrupt, a runtime stepper only gets it on the same step pin
+	fixedStepper.connectToPins(99, DIAG_1);
+	setupStepper(stepper, KIND_FLOAT);
+	CHECK(FixedStepInterrupt<STEP_1>::use(stepper), "fixed step interrupt refused on its step pin");
+	CHECK(!FixedStepInterrupt<STEP_0>::use(stepper), "fixed step interrupt of STEP_0 taken by a stepper on STEP_1");
+
+	// Same steps as the runtime interrupt (connecting again sets the runtime interrupt)
+	for (long distance : {1L, 3L, (long) STD_FEED_DIST / 100, (long) STD_FEED_DIST}) {
+		setupStepper(stepper, KIND_FLOAT);
+		std::vector<int64_t> runtimePeriods = runTimerMove(stepper, distance, stepPinMask, "runtime");
+		fixedStepper.setSpeedInStepsPerSecond(SPEED);
+		fixedStepper.setAccelerationInStepsPerSecondPerSecond(ACCEL);
+		std::vector<int64_t> fixedPeriods = runTimerMove(fixedStepper, distance, stepPinMask, "fixed");
+		CHECK(runtimePeriods == fixedPeriods, "%ld steps: fixed step interrupt steps differ from the runtime one", distance);
+	}
+
+	// Cost per step of both interrupts (host)
+	printf("Step interrupt cost per step (host):\n");
+	setupStepper(stepper, KIND_FLOAT);
+	double runtimeNs = nsPerCall(200, [&]() { runTimerMove(stepper, STD_FEED_DIST, stepPinMask, "runtime"); });
+	double fixedNs = nsPerCall(200, [&]() { runTimerMove(fixedStepper, STD_FEED_DIST, stepPinMask, "fixed"); });
+	printf("  %-12s %6.2f ns/step\n", "runtime", runtimeNs / STD_FEED_DIST);
+	printf("  %-12s %6.2f ns/step\n", "fixed", fixedNs / STD_FEED_DIST);
+
+	printf("%s (%d failed checks)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+/*
+ * Name:	HomingTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Host check of the speed around two speed homing (moveToHome with an external endstop signal): the homing speeds are
+ * only used while homing, the speed is back to the normal speed when homing is done and when it is aborted with
+ * stopMovement() (e.g. a cancelled move).
+*/
+
+#include "HostTest.h"
+
+static SpeedyStepper4Purr stepper(0);
+
+static const float approachSpeed = 15000;
+static const float reprobeSpeed = 1000;
+static const long backOff = 400;
+
+// Cruise speed (steps/s) of a long move planned with the current speed
+static float plannedSpeed() {
+	std::vector<uint32_t> periods = plannedPeriods(stepper, 100000, KIND_FLOAT);
+	uint32_t shortest = UINT32_MAX;
+	for (uint32_t period : periods) {
+		shortest = (period < shortest) ? period : shortest;
+	}
+	return 1000000.0f * 65536.0f / shortest;
+}
+
+static bool nearSpeed(float speed, float expected) {
+	return fabsf(speed - expected) < expected * 0.01f;
+}
+
+// Homing call with the (external) endstop signal, 1 US later than the last one
+static byte homeStep(bool endStop) {
+	HostClock::advance(1);
+	return stepper.moveToHome(1, 6000, endStop);
+}
+
+// Home up to the re-probe at the slow speed (endstop hit by the approach, released by the back off, 200 MS)
+static void homeToReprobe() {
+	homeStep(false);
+	homeStep(true);
+	for (long i = 0; i < 200000; i++) {
+		homeStep(false);
+	}
+}
+
+int main() {
+	setupStepper(stepper, KIND_FLOAT);
+	stepper.setHomingSpeeds(approachSpeed, reprobeSpeed, backOff);
+	CHECK(nearSpeed(plannedSpeed(), SPEED), "speed %.0f before homing, expected %d", plannedSpeed(), SPEED);
+
+	// Aborted while approaching the endstop
+	CHECK(homeStep(false) == 0, "homing not started");
+	CHECK(nearSpeed(plannedSpeed(), approachSpeed), "approach speed %.0f, expected %.0f", plannedSpeed(), approachSpeed);
+	stepper.stopMovement();
+	CHECK(nearSpeed(plannedSpeed(), SPEED), "speed %.0f after aborted approach, expected %d", plannedSpeed(), SPEED);
+	CHECK(homeStep(false) == 0, "homing not started again after the abort");
+	stepper.stopMovement();
+
+	// Aborted while re-probing (endstop hit, back off, re-probe at the slow speed)
+	homeToReprobe();
+	CHECK(nearSpeed(plannedSpeed(), reprobeSpeed), "re-probe speed %.0f, expected %.0f", plannedSpeed(), reprobeSpeed);
+	stepper.stopMovement();
+	CHECK(nearSpeed(plannedSpeed(), SPEED), "speed %.0f after aborted re-probe, expected %d", plannedSpeed(), SPEED);
+
+	// Homed
+	homeToReprobe();
+	byte result = homeStep(true);
+	CHECK(result == 1, "homing result %d", result);
+	CHECK(nearSpeed(plannedSpeed(), SPEED), "speed %.0f after homing, expected %d", plannedSpeed(), SPEED);
+
+	printf("%s\n", failures ? "FAILED" : "homing speeds restored");
+	return failures ? 1 : 0;
+}
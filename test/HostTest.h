@@ -0,0 +1,92 @@
+/*
+ * Name:	HostTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Helpers for the host tests of SpeedyStepper4Purr (built on Linux against the stubs in stubs/, see CMakeLists.txt).
+ * The motion settings are the ones of PP3000S_CONFIG.h, so the tests check the moves the PurrPleaser actually makes.
+*/
+
+#ifndef _HOSTTEST_h
+#define _HOSTTEST_h
+
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "SpeedyStepper4Purr.h"
+#include "RampTable.h"
+#include "PP3000S_CONFIG.h"
+
+// Failed checks of the running test
+inline int failures = 0;
+
+#define CHECK(condition, ...) do { \
+	if (!(condition)) { \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+		failures++; \
+	} \
+} while (0)
+
+// Ramp of the configuration (as in PP3000S_PicoW.ino)
+inline constexpr RampTable<SPEED, ACCEL> rampTable;
+
+// Ramp math / profile of a planned move
+enum RampKind : byte {
+	KIND_FLOAT,
+	KIND_FIXED,
+	KIND_TABLE,
+	KIND_SCURVE
+};
+
+inline const char *rampName(byte kind) {
+	static const char *names[] = {"float", "fixed point", "ramp table", "S-curve"};
+	return names[kind];
+}
+
+// Set up a polled stepper like FP3000::SetupMotor() does (pins are stubs)
+// NOTE, the stepper registers itself for the polled step scheduler (see connectToPins), so it has to
+// live until the end of the test (use one stepper and set it up again for each case).
+inline void setupStepper(SpeedyStepper4Purr &stepper, byte kind, float speed = SPEED, float accel = ACCEL) {
+	stepper.connectToPins(STEP_1, DIR_1, 99, DIAG_1);
+	stepper.setStepMode(SpeedyStepper4Purr::STEP_POLLED);
+	stepper.setSpeedInStepsPerSecond(speed);
+	stepper.setAccelerationInStepsPerSecondPerSecond(accel);
+	stepper.setJerkInStepsPerSecondPerSecondPerSecond(JERK);
+	stepper.setFixedPointRamp(kind == KIND_FIXED);
+	if (kind == KIND_TABLE) {
+		stepper.setRampTable(rampTable.period, rampTable.length, rampTable.speed, rampTable.accel);
+	}
+	else {
+		stepper.setRampTable(nullptr, 0, 0, 0);
+	}
+	stepper.setCurrentPositionInSteps(0);
+	stepper.stopMovement();
+}
+
+inline byte motionProfile(byte kind) {
+	return (kind == KIND_SCURVE) ? SpeedyStepper4Purr::PROFILE_SCURVE : SpeedyStepper4Purr::PROFILE_TRAPEZOID;
+}
+
+// Planned step periods of a move (US as Q16)
+inline std::vector<uint32_t> plannedPeriods(SpeedyStepper4Purr &stepper, long distance, byte kind) {
+	std::vector<uint32_t> periods(labs(distance));
+	long samples = stepper.sampleTrajectory(distance, motionProfile(kind), periods.data(), periods.size());
+	periods.resize(samples);
+	return periods;
+}
+
+// Time per call of a function (ns)
+template <typename Function>
+double nsPerCall(long calls, Function function) {
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < calls; i++) {
+		function();
+	}
+	std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+	return time.count() / calls;
+}
+
+#endif
@@ -0,0 +1,105 @@
+/*
+ * Name:	PioMoveTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Host check of the STEP_PIO move set up (the PIO and DMA are stubs that keep what a move sends): the DMA chain sends the
+ * planned step periods, only the accelerating and decelerating steps are computed, the cruise is one period sent again for
+ * every cruise step. Also prints the time to start a move (host), which has to stay about the same for longer moves.
+*/
+
+#include "HostTest.h"
+
+#define PIO_CYCLES_PER_US	10			// As in SpeedyStepper4Purr.cpp
+#define PIO_STEP_CYCLES		11
+
+static SpeedyStepper4Purr stepper(0);
+
+// Distances checked (steps)
+static const long distances[] = {
+	1, 2, 3,
+	STD_FEED_DIST / 100,			// Smallest MoveCycleAccurate() step
+	STD_FEED_DIST / 10,
+	STD_FEED_DIST,
+	PUMP_MAX_RANGE,
+	100000							// Long cruise
+};
+
+// Periods the DMA chain of the last move sends (PIO cycles)
+static std::vector<uint32_t> sentPeriods(long &computedPeriods, long &cruiseSteps) {
+	std::vector<uint32_t> periods;
+	int channel = HostDma::started;
+
+	computedPeriods = 0;
+	cruiseSteps = 0;
+	for (int segments = 0; channel >= 0 && segments < 3; segments++) {
+		const volatile uint32_t *read = (const volatile uint32_t *) HostDma::read[channel];
+		for (uint i = 0; i < HostDma::count[channel]; i++) {
+			periods.push_back((uint32_t) (HostDma::config[channel].readIncrement ? read[i] : read[0]));
+		}
+		if (HostDma::config[channel].readIncrement) {
+			computedPeriods += HostDma::count[channel];
+		}
+		else {
+			cruiseSteps += HostDma::count[channel];
+		}
+		channel = (HostDma::config[channel].chainTo != (uint) channel) ? (int) HostDma::config[channel].chainTo : -1;
+	}
+	return periods;
+}
+
+// Start a PIO move (the stubbed state machine is done at once)
+static void startMove(long distance, byte kind) {
+	stepper.setCurrentPositionInSteps(0);
+	stepper.stopMovement();
+	HostDma::started = -1;
+	stepper.setupMoveInSteps(distance, motionProfile(kind));
+	stepper.processMovement();
+}
+
+int main() {
+	for (byte kind = KIND_FLOAT; kind <= KIND_SCURVE; kind++) {
+		for (long distance : distances) {
+			const char *name = rampName(kind);
+			setupStepper(stepper, kind);
+			stepper.setStepMode(SpeedyStepper4Purr::STEP_PIO);
+			std::vector<uint32_t> planned = plannedPeriods(stepper, distance, kind);
+
+			startMove(distance, kind);
+			long computedPeriods;
+			long cruiseSteps;
+			std::vector<uint32_t> sent = sentPeriods(computedPeriods, cruiseSteps);
+
+			CHECK((long) sent.size() == distance, "%s, %ld steps: %ld periods sent", name, distance, (long) sent.size());
+			CHECK(computedPeriods <= 2 * SpeedyStepper4Purr::PIO_RAMP_STEPS, "%s, %ld steps: %ld periods computed",
+				name, distance, computedPeriods);
+			long off = 0;
+			for (size_t i = 0; i < sent.size() && i < planned.size(); i++) {
+				long cycles = max((long) (((uint64_t) planned[i] * PIO_CYCLES_PER_US) >> 16) - PIO_STEP_CYCLES, 0L);
+				if (labs((long) sent[i] - cycles) > 1) {
+					off++;
+				}
+			}
+			CHECK(off == 0, "%s, %ld steps: %ld periods off the plan", name, distance, off);
+			CHECK(stepper.processMovement() && stepper.getCurrentPositionInSteps() == distance,
+				"%s, %ld steps: move not complete", name, distance);
+		}
+	}
+
+	// Time to start a move (host), computing only the ramps
+	printf("Time to start a PIO move (host):\n");
+	setupStepper(stepper, KIND_FLOAT);
+	stepper.setStepMode(SpeedyStepper4Purr::STEP_PIO);
+	for (long distance : {(long) STD_FEED_DIST, 100000L}) {
+		double ns = nsPerCall(1000, [&]() { startMove(distance, KIND_FLOAT); });
+		long computedPeriods;
+		long cruiseSteps;
+		sentPeriods(computedPeriods, cruiseSteps);
+		printf("  %6ld steps: %8.0f ns (%ld periods computed, %ld cruise steps)\n", distance, ns, computedPeriods,
+			cruiseSteps);
+	}
+
+	printf("%s (%d failed checks)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
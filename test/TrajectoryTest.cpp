@@ -0,0 +1,246 @@
+/*
+ * Name:	TrajectoryTest
+ * Author:	Poing3000
+ * Status:	Beta
+ *
+ * Description:
+ * Host check of the velocity profiles of SpeedyStepper4Purr (replaces a check on the device, see CHECK_TRAJECTORY):
+ * - Planned moves (sampleTrajectory) of the feeding distances, incl. the small steps of MoveCycleAccurate() (1% and 10% of
+ *   STD_FEED_DIST) and single steps: every step is planned, speed and acceleration stay within SPEED / ACCEL, the ramp
+ *   only accelerates, cruises and decelerates, and the move takes about as long as the ideal profile.
+ * - Executed moves (polled steps on the simulated clock): the steps come at the planned periods.
+ * - Cost per step of planning the ramp (host time, to compare the ramp kinds; the RP2040 has no FPU, so its ratio differs).
+*/
+
+#include "HostTest.h"
+
+// Tolerances
+// The ramp starts with a period of 1/sqrt(2*ACCEL) instead of sqrt(2/ACCEL), so its first steps are faster than the ideal
+// trapezoid: about 3 steps of extra acceleration (matters on the short moves) and 14.6ms less per move (the S-curve is
+// about 5ms slower instead).
+#define SPEED_TOLERANCE		0.01		// Peak speed above SPEED
+#define ACCEL_TOLERANCE		0.05		// Mean acceleration (from standstill to the peak) above ACCEL
+#define ACCEL_START_STEPS	3.0			// Extra acceleration of the first steps (in steps, spread over the ramp)
+#define TIME_TOLERANCE		0.05		// Duration of a move off the ideal trapezoid
+#define TIME_OFFSET			15000.0		// Time gained or lost on the start of the ramp (US)
+// The float and fixed point ramps decelerate with the first order step p * (1 + a * p^2), which does not get back to the
+// start speed: they stop from up to 1400 steps/s (the ramp table and the S-curve stop from their start speed).
+#define STOP_SPEED_FACTOR	3.5			// Speed of the last step, times sqrt(2 * ACCEL)
+
+// Distances checked (steps)
+static const long distances[] = {
+	1, 2, 3,
+	STD_FEED_DIST / 100,			// Smallest MoveCycleAccurate() step
+	STD_FEED_DIST / 10,				// Largest MoveCycleAccurate() step (ACCURATE_MAX_STEP)
+	STD_FEED_DIST / 2,				// Pre-position
+	STD_FEED_DIST,
+	PUMP_MAX_RANGE
+};
+
+static SpeedyStepper4Purr stepper(0);
+
+// Ideal duration of a trapezoid move (US)
+static double idealDuration(long distance) {
+	double rampSteps = (double) SPEED * SPEED / (2.0 * ACCEL);
+	if (distance <= 2 * rampSteps) {
+		return 2.0 * sqrt(distance / (double) ACCEL) * 1E6;
+	}
+	return (2.0 * SPEED / ACCEL + (distance - 2 * rampSteps) / SPEED) * 1E6;
+}
+
+// Check the planned profile of a move
+static void checkPlannedMove(byte kind, long distance) {
+	setupStepper(stepper, kind);
+	std::vector<uint32_t> periods = plannedPeriods(stepper, distance, kind);
+	const char *name = rampName(kind);
+
+	CHECK((long) periods.size() == distance, "%s, %ld steps: %ld steps planned", name, distance, (long) periods.size());
+	if ((long) periods.size() != distance) {
+		return;
+	}
+
+	// Peak (first and last step at the shortest period)
+	long firstPeak = 0;
+	long lastPeak = 0;
+	double duration = 0;
+	for (long i = 0; i < distance; i++) {
+		CHECK(periods[i] > 0 && periods[i] != 0xFFFFFFFF, "%s, %ld steps: step %ld has no period", name, distance, i);
+		if (periods[i] < periods[firstPeak]) {
+			firstPeak = lastPeak = i;
+		}
+		else if (periods[i] == periods[firstPeak]) {
+			lastPeak = i;
+		}
+		duration += periods[i] / 65536.0;
+	}
+	double peakSpeed = 65536.0 * 1E6 / periods[firstPeak];
+	double accel = peakSpeed * peakSpeed / (2.0 * (firstPeak + 1));
+	double stopSpeed = 65536.0 * 1E6 / periods[distance - 1];
+	double decel = (peakSpeed * peakSpeed - stopSpeed * stopSpeed) / (2.0 * (distance - lastPeak));
+	double accelLimit = ACCEL * (1 + ACCEL_TOLERANCE + ACCEL_START_STEPS / (firstPeak + 1));
+	double decelLimit = ACCEL * (1 + ACCEL_TOLERANCE + ACCEL_START_STEPS / (distance - lastPeak));
+
+	CHECK(peakSpeed <= SPEED * (1 + SPEED_TOLERANCE), "%s, %ld steps: peak speed %.0f steps/s", name, distance, peakSpeed);
+	CHECK(accel <= accelLimit, "%s, %ld steps: acceleration %.0f steps/s^2", name, distance, accel);
+	CHECK(decel <= decelLimit, "%s, %ld steps: deceleration %.0f steps/s^2", name, distance, decel);
+	CHECK(stopSpeed <= STOP_SPEED_FACTOR * sqrt(2.0 * ACCEL), "%s, %ld steps: stops from %.0f steps/s", name, distance,
+		stopSpeed);
+
+	// Accelerate, cruise, decelerate (no step faster than the one before while accelerating and vice versa)
+	for (long i = 1; i <= firstPeak; i++) {
+		CHECK(periods[i] <= periods[i - 1], "%s, %ld steps: step %ld slower while accelerating", name, distance, i);
+	}
+	for (long i = lastPeak + 1; i < distance; i++) {
+		CHECK(periods[i] >= periods[i - 1], "%s, %ld steps: step %ld faster while decelerating", name, distance, i);
+	}
+
+	// Long moves reach the speed, all take about the ideal time
+	if (distance >= (long) ((double) SPEED * SPEED / ACCEL) + 2) {
+		CHECK(peakSpeed >= SPEED * (1 - SPEED_TOLERANCE), "%s, %ld steps: peak speed %.0f steps/s not reached",
+			name, distance, peakSpeed);
+	}
+	double ideal = idealDuration(distance);
+	CHECK(fabs(duration - ideal) <= ideal * TIME_TOLERANCE + TIME_OFFSET, "%s, %ld steps: takes %.0fus, ideal %.0fus",
+		name, distance, duration, ideal);
+}
+
+// Run a move with polled steps on the simulated clock, the steps have to come at the planned periods
+static void checkExecutedMove(byte kind, long distance) {
+	setupStepper(stepper, kind);
+	std::vector<uint32_t> periods = plannedPeriods(stepper, distance, kind);
+	const char *name = rampName(kind);
+
+	stepper.setupMoveInSteps(distance, motionProfile(kind));
+	long lastPosition = 0;
+	uint64_t lastStep = HostClock::now_InUS;
+	long off = 0;
+	for (long i = 0; i < 10000000 && !stepper.processMovement(); i++) {
+		long position = stepper.getCurrentPositionInSteps();
+		if (position != lastPosition) {
+			long step = labs(position) - 1;
+			long period = (long) (HostClock::now_InUS - lastStep);
+			// The first period counts from the start of the move, polled steps are whole US
+			if (step < (long) periods.size() && labs(period - (long) (periods[step] >> 16)) > 1) {
+				off++;
+			}
+			lastPosition = position;
+			lastStep = HostClock::now_InUS;
+		}
+		HostClock::advance(1);
+	}
+	CHECK(stepper.getCurrentPositionInSteps() == distance, "%s, %ld steps: stopped at %ld", name, distance,
+		stepper.getCurrentPositionInSteps());
+	CHECK(off == 0, "%s, %ld steps: %ld steps off their planned period", name, distance, off);
+}
+
+// Queue segments of the smallest MoveCycleAccurate() step: in the same direction they run as one move (no step as slow as a
+// start in the middle), with a dwell or a change of direction they stop in between
+static void checkQueuedMoves(byte kind) {
+	const long increment = STD_FEED_DIST / 100;
+	const char *name = rampName(kind);
+
+	for (int dwell = 0; dwell <= 1; dwell++) {
+		setupStepper(stepper, kind);
+		std::vector<uint32_t> single = plannedPeriods(stepper, increment, kind);
+		for (int i = 0; i < 3; i++) {
+			stepper.queueRelativeMoveInSteps(increment, dwell ? 200 : 0, motionProfile(kind));
+		}
+
+		long lastPosition = 0;
+		uint64_t lastStep = HostClock::now_InUS;
+		long slowSteps = 0;
+		for (long i = 0; i < 10000000 && !stepper.processMovement(); i++) {
+			long position = stepper.getCurrentPositionInSteps();
+			if (position != lastPosition) {
+				if (position > 2 && position < 3 * increment - 2 && HostClock::now_InUS - lastStep >= (single[0] >> 16)) {
+					slowSteps++;
+				}
+				lastPosition = position;
+				lastStep = HostClock::now_InUS;
+			}
+			HostClock::advance(1);
+		}
+		CHECK(stepper.getCurrentPositionInSteps() == 3 * increment, "%s, queued: stopped at %ld", name,
+			stepper.getCurrentPositionInSteps());
+		if (dwell) {
+			CHECK(slowSteps > 0, "%s, queued with dwell: no stop between the segments", name);
+		}
+		else {
+			CHECK(slowSteps == 0, "%s, queued: %ld steps as slow as a start, segments not blended", name, slowSteps);
+		}
+	}
+}
+
+// The first move of MoveCycleAccurate(): the pre-position and the first small step are queued as two segments, they have to
+// run as one move (the steps come at the planned periods of the whole distance)
+static void checkBlendedMove(byte kind) {
+	const long prePosition = STD_FEED_DIST / 2;
+	const long target = prePosition + STD_FEED_DIST / 100;
+	const char *name = rampName(kind);
+
+	setupStepper(stepper, kind);
+	std::vector<uint32_t> periods = plannedPeriods(stepper, target, kind);
+	stepper.queueMoveInSteps(prePosition, 0, motionProfile(kind));
+	stepper.queueMoveInSteps(target, 0, motionProfile(kind));
+
+	long lastPosition = 0;
+	uint64_t lastStep = HostClock::now_InUS;
+	long off = 0;
+	for (long i = 0; i < 10000000 && !stepper.processMovement(); i++) {
+		long position = stepper.getCurrentPositionInSteps();
+		if (position != lastPosition) {
+			long period = (long) (HostClock::now_InUS - lastStep);
+			if (position <= target && labs(period - (long) (periods[position - 1] >> 16)) > 1) {
+				off++;
+			}
+			lastPosition = position;
+			lastStep = HostClock::now_InUS;
+		}
+		HostClock::advance(1);
+	}
+	CHECK(stepper.getCurrentPositionInSteps() == target, "%s, pre-position + small step: stopped at %ld", name,
+		stepper.getCurrentPositionInSteps());
+	CHECK(off == 0, "%s, pre-position + small step: %ld steps off a single move (stop at the pre-position?)", name, off);
+}
+
+int main() {
+	printf("SPEED %d steps/s, ACCEL %d steps/s^2, JERK %d steps/s^3, STD_FEED_DIST %d steps\n", SPEED, ACCEL, JERK, STD_FEED_DIST);
+
+	for (byte kind = KIND_FLOAT; kind <= KIND_SCURVE; kind++) {
+		for (long distance : distances) {
+			checkPlannedMove(kind, distance);
+			checkExecutedMove(kind, distance);
+		}
+		checkQueuedMoves(kind);
+		checkBlendedMove(kind);
+	}
+
+	// Cost per step of planning a feeding stroke
+	printf("Planning cost per step (host):\n");
+	for (byte kind = KIND_FLOAT; kind <= KIND_SCURVE; kind++) {
+		setupStepper(stepper, kind);
+		std::vector<uint32_t> periods(STD_FEED_DIST);
+		double ns = nsPerCall(2000, [&]() {
+			stepper.sampleTrajectory(STD_FEED_DIST, motionProfile(kind), periods.data(), periods.size());
+		});
+		printf("  %-12s %6.2f ns/step\n", rampName(kind), ns / STD_FEED_DIST);
+	}
+
+	// Cost per step of running a feeding stroke with polled steps (the clock moves by the shortest period per poll, so
+	// this is mostly the cost of the step and its ramp, only the slow steps of the ramps add some empty polls)
+	printf("Polled step cost (host):\n");
+	for (byte kind = KIND_FLOAT; kind <= KIND_SCURVE; kind++) {
+		setupStepper(stepper, kind);
+		double ns = nsPerCall(20, [&]() {
+			stepper.setCurrentPositionInSteps(0);
+			stepper.setupMoveInSteps(STD_FEED_DIST, motionProfile(kind));
+			while (!stepper.processMovement()) {
+				HostClock::advance(1000000 / SPEED);
+			}
+		});
+		printf("  %-12s %6.2f ns/step\n", rampName(kind), ns / STD_FEED_DIST);
+	}
+
+	printf("%s (%d failed checks)\n", failures ? "FAILED" : "PASSED", failures);
+	return failures ? 1 : 0;
+}
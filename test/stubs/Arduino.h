@@ -0,0 +1,46 @@
+/*
+ * Host stub of the Arduino core (arduino-pico), just enough to build SpeedyStepper4Purr on Linux.
+ * micros() / millis() run on a simulated clock (see HostClock), pins do nothing.
+*/
+
+#ifndef _HOST_ARDUINO_h
+#define _HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef unsigned int uint;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+
+#define __not_in_flash_func(x) x
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+using std::min;
+using std::max;
+
+// Simulated clock (US), advanced by the tests
+namespace HostClock {
+	extern uint64_t now_InUS;
+	inline void advance(uint64_t us) { now_InUS += us; }
+}
+
+inline unsigned long micros() { return (unsigned long) (uint32_t) HostClock::now_InUS; }
+inline unsigned long millis() { return (unsigned long) (uint32_t) (HostClock::now_InUS / 1000); }
+
+inline void pinMode(int, int) {}
+inline void digitalWrite(int, int) {}
+inline int digitalRead(int) { return HIGH; }
+inline int digitalPinToInterrupt(int pin) { return pin; }
+inline void attachInterrupt(int, void (*)(), int) {}
+inline void detachInterrupt(int) {}
+
+#endif
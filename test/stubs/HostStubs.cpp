@@ -0,0 +1,11 @@
+/*
+ * Definitions for the host stubs (simulated clock and SIO registers).
+*/
+
+#include <Arduino.h>
+#include <hardware/structs/sio.h>
+
+uint64_t HostClock::now_InUS = 0;
+
+static sio_hw_t hostSio;
+sio_hw_t *sio_hw = &hostSio;
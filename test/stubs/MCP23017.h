@@ -0,0 +1,15 @@
+// Host stub of the MCP23017 library (only the type is used by SpeedyStepper4Purr)
+#ifndef _HOST_MCP23017_h
+#define _HOST_MCP23017_h
+
+#include <Arduino.h>
+
+enum MCP23017Port { A, B };
+
+class MCP23017 {
+public:
+	MCP23017(uint8_t) {}
+	bool getPin(uint8_t, MCP23017Port) { return false; }
+};
+
+#endif
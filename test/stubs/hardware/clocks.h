@@ -0,0 +1,10 @@
+// Host stub of the Pico SDK clocks
+#ifndef _HOST_HARDWARE_CLOCKS_h
+#define _HOST_HARDWARE_CLOCKS_h
+
+#include <stdint.h>
+
+enum clock_index { clk_sys };
+inline uint32_t clock_get_hz(enum clock_index) { return 133000000; }
+
+#endif
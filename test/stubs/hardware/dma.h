@@ -0,0 +1,51 @@
+// Host stub of the Pico SDK DMA (STEP_PIO is not simulated: the channels are handed out in turn and their
+// configuration is kept in HostDma, so a test can read back what a move sends; no transfer ever runs)
+#ifndef _HOST_HARDWARE_DMA_h
+#define _HOST_HARDWARE_DMA_h
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+enum dma_channel_transfer_size { DMA_SIZE_8, DMA_SIZE_16, DMA_SIZE_32 };
+
+typedef struct {
+	bool readIncrement;
+	uint chainTo;
+} dma_channel_config;
+
+namespace HostDma {
+	inline int nextChannel = 0;
+	inline dma_channel_config config[12];
+	inline const volatile void *read[12];
+	inline uint count[12];
+	inline int started = -1;
+}
+
+typedef struct {
+	struct { volatile uint32_t read_addr, write_addr, transfer_count, ctrl_trig; } ch[12];
+} dma_hw_t;
+
+inline dma_hw_t host_dma;
+inline dma_hw_t *dma_hw = &host_dma;
+
+inline int dma_claim_unused_channel(bool) { return HostDma::nextChannel++ % 12; }
+inline dma_channel_config dma_channel_get_default_config(uint channel) { return dma_channel_config{true, channel}; }
+inline dma_channel_config dma_get_channel_config(uint channel) { return HostDma::config[channel]; }
+inline void channel_config_set_transfer_data_size(dma_channel_config *, enum dma_channel_transfer_size) {}
+inline void channel_config_set_read_increment(dma_channel_config *config, bool increment) { config->readIncrement = increment; }
+inline void channel_config_set_write_increment(dma_channel_config *, bool) {}
+inline void channel_config_set_dreq(dma_channel_config *, uint) {}
+inline void channel_config_set_chain_to(dma_channel_config *config, uint channel) { config->chainTo = channel; }
+inline void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *,
+	const volatile void *read, uint count, bool) {
+	HostDma::config[channel] = *config;
+	HostDma::read[channel] = read;
+	HostDma::count[channel] = count;
+}
+inline void dma_channel_set_config(uint channel, const dma_channel_config *config, bool) { HostDma::config[channel] = *config; }
+inline void dma_channel_start(uint channel) { HostDma::started = channel; }
+inline void dma_channel_abort(uint) {}
+inline bool dma_channel_is_busy(uint) { return false; }
+
+#endif
@@ -0,0 +1,59 @@
+// Host stub of the Pico SDK PIO (STEP_PIO is not simulated, the calls do nothing, the state machine waits at its pull)
+#ifndef _HOST_HARDWARE_PIO_h
+#define _HOST_HARDWARE_PIO_h
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+typedef struct {
+	volatile uint32_t fdebug;
+	volatile uint32_t txf[4];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+
+inline pio_hw_t host_pio0;
+inline PIO pio0 = &host_pio0;
+inline pio_hw_t host_pio1;
+inline PIO pio1 = &host_pio1;
+
+typedef struct pio_program {
+	const uint16_t *instructions;
+	uint8_t length;
+	int8_t origin;
+} pio_program_t;
+
+typedef struct { uint32_t unused; } pio_sm_config;
+
+enum pio_src_dest { pio_pins, pio_x, pio_y, pio_null, pio_isr, pio_osr };
+
+#define PIO_FDEBUG_TXSTALL_LSB 24
+
+inline pio_sm_config pio_get_default_sm_config() { return pio_sm_config(); }
+inline void sm_config_set_wrap(pio_sm_config *, uint, uint) {}
+inline void sm_config_set_sideset(pio_sm_config *, uint, bool, bool) {}
+inline void sm_config_set_sideset_pins(pio_sm_config *, uint) {}
+inline void sm_config_set_clkdiv(pio_sm_config *, float) {}
+inline void sm_config_set_out_shift(pio_sm_config *, bool, bool, uint) {}
+inline bool pio_can_add_program(PIO, const pio_program_t *) { return false; }
+inline uint pio_add_program(PIO, const pio_program_t *) { return 0; }
+inline int pio_claim_unused_sm(PIO, bool) { return -1; }
+inline void pio_gpio_init(PIO, uint) {}
+inline void pio_sm_set_consecutive_pindirs(PIO, uint, uint, uint, bool) {}
+inline void pio_sm_init(PIO, uint, uint, const pio_sm_config *) {}
+inline void pio_sm_set_enabled(PIO, uint, bool) {}
+inline uint pio_sm_get_pc(PIO, uint) { return 0; }
+inline uint pio_sm_get_tx_fifo_level(PIO, uint) { return 0; }
+inline bool pio_sm_is_tx_fifo_empty(PIO, uint) { return true; }
+inline bool pio_sm_is_tx_fifo_full(PIO, uint) { return true; }
+inline void pio_sm_clear_fifos(PIO, uint) {}
+inline void pio_sm_exec(PIO, uint, uint) {}
+inline uint32_t pio_sm_get(PIO, uint) { return 0; }
+inline uint pio_get_dreq(PIO, uint, bool) { return 0; }
+inline uint pio_encode_jmp(uint) { return 0; }
+inline uint pio_encode_sideset(uint, uint) { return 0; }
+inline uint pio_encode_mov(enum pio_src_dest, enum pio_src_dest) { return 0; }
+inline uint pio_encode_push(bool, bool) { return 0; }
+inline void tight_loop_contents() {}
+
+#endif
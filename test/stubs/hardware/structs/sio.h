@@ -0,0 +1,14 @@
+// Host stub of the RP2040 SIO registers (writes go to a plain struct)
+#ifndef _HOST_HARDWARE_STRUCTS_SIO_h
+#define _HOST_HARDWARE_STRUCTS_SIO_h
+
+#include <stdint.h>
+
+typedef struct {
+	volatile uint32_t gpio_set;
+	volatile uint32_t gpio_clr;
+} sio_hw_t;
+
+extern sio_hw_t *sio_hw;
+
+#endif
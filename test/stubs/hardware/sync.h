@@ -0,0 +1,11 @@
+// Host stub of the Pico SDK interrupt locks (single threaded)
+#ifndef _HOST_HARDWARE_SYNC_h
+#define _HOST_HARDWARE_SYNC_h
+
+#include <stdint.h>
+
+inline uint32_t save_and_disable_interrupts() { return 0; }
+inline void restore_interrupts(uint32_t) {}
+#define __dmb()
+
+#endif
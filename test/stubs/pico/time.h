@@ -0,0 +1,59 @@
+// Host stub of the Pico SDK alarm pool: one alarm at a time, fired by the test with HostAlarm::fire()
+#ifndef _HOST_PICO_TIME_h
+#define _HOST_PICO_TIME_h
+
+#include <stdint.h>
+#include "Arduino.h"
+
+typedef int32_t alarm_id_t;
+typedef struct alarm_pool alarm_pool_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+namespace HostAlarm {
+	inline alarm_callback_t callback = nullptr;
+	inline void *userData = nullptr;
+	inline uint64_t due_InUS = 0;
+	inline alarm_id_t id = 0;
+	inline bool armed = false;
+
+	// Move the clock to the alarm and run its callback (rescheduled like the SDK does: a negative period counts from
+	// the time it was due, a positive one from now, 0 stops it)
+	//  Exit:  false returned if no alarm was armed
+	inline bool fire() {
+		if (!armed) {
+			return false;
+		}
+		if (HostClock::now_InUS < due_InUS) {
+			HostClock::now_InUS = due_InUS;
+		}
+		int64_t period = callback(id, userData);
+		if (period < 0) {
+			due_InUS += -period;
+		}
+		else if (period > 0) {
+			due_InUS = HostClock::now_InUS + period;
+		}
+		else {
+			armed = false;
+		}
+		return true;
+	}
+}
+
+inline alarm_pool_t *alarm_pool_create_with_unused_hardware_alarm(unsigned) { return nullptr; }
+inline alarm_id_t alarm_pool_add_alarm_in_us(alarm_pool_t *, uint64_t us, alarm_callback_t callback, void *userData, bool) {
+	HostAlarm::callback = callback;
+	HostAlarm::userData = userData;
+	HostAlarm::due_InUS = HostClock::now_InUS + us;
+	HostAlarm::armed = true;
+	return ++HostAlarm::id;
+}
+inline bool alarm_pool_cancel_alarm(alarm_pool_t *, alarm_id_t id) {
+	if (!HostAlarm::armed || id != HostAlarm::id) {
+		return false;
+	}
+	HostAlarm::armed = false;
+	return true;
+}
+
+#endif